@@ -5,6 +5,14 @@
 #include <assert.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // ifndef让使用者可以自定义初始栈大小
 #ifndef LEPT_PARSE_STACK_INIT_SIZE 
@@ -15,11 +23,20 @@
 // 这里的赋值是为了让放入栈中的数据达到内存连续; 或者说把分配给栈的空间拿来放置c
 #define PUTC(c, ch) do { *(char*)lept_context_push(c, sizeof(char)) = (ch); } while(0)
 #define STRING_ERROR(ret) do { c->top = head; return ret; } while(0)
+// 定义LEPT_PARSE_NO_STATS可以在编译期把统计代码整个去掉；否则不统计时只多一次判空
+#ifdef LEPT_PARSE_NO_STATS
+#define STATS_ON(c) 0
+#else
+#define STATS_ON(c) ((c)->stats != NULL)
+#endif
 
 typedef struct{
     const char* json;
     char* stack;
     size_t size, top;
+    lept_parse_stats* stats;    // 为NULL时不统计
+    size_t depth;               // 当前嵌套层数，只在统计时维护
+    int pack;                   // 全是数字的数组存成紧凑数组（lept_parse_packed）
 }lept_context;
 
 // 压栈 : 其实就是申请了一块地方给PUTC、然后在PUTC中让申请的空间被赋值了ch
@@ -32,9 +49,15 @@ static void* lept_context_push(lept_context* c, size_t size){
         while (c->top + size >= c->size)
             c->size += c->size >> 1;
         c->stack = (char*)realloc(c->stack, c->size);   // 每一次realloc都会更换栈的地址
+        if (STATS_ON(c)) {
+            c->stats->reallocs++;
+            c->stats->allocs++;
+        }
     }
     ret = c->stack + c->top;    // top的位置（相当于栈的地址+偏移量）、链表栈的意思
     c->top += size;             // 这个top是顺序栈的意思
+    if (STATS_ON(c) && c->top > c->stats->stackPeak)
+        c->stats->stackPeak = c->top;
     return ret;
 }
 
@@ -45,6 +68,30 @@ static void* lept_context_pop(lept_context* c, size_t size){
     return c->stack + (c->top -= size);
 }
 
+// 非空数组/对象的元素前面多分配一个uint64_t，缓存lept_hash的结果（0表示还没算过）：
+// 只有它们才需要缓存，放在这里lept_value就还是24个字节
+#define LEPT_HASH_HEADER sizeof(uint64_t)
+
+static void* lept_elements_alloc(size_t size){
+    char* p = (char*)malloc(LEPT_HASH_HEADER + size);
+    *(uint64_t*)p = 0;
+    return p + LEPT_HASH_HEADER;
+}
+
+static void lept_elements_free(void* e){
+    if (e != NULL)
+        free((char*)e - LEPT_HASH_HEADER);
+}
+
+// lept_hash对const的树写缓存，可能有多个线程同时读写：按relaxed原子访问，反正谁算出来的都一样
+static uint64_t lept_hash_cache_load(const void* e){
+    return std::atomic_ref<uint64_t>(*(uint64_t*)((char*)e - LEPT_HASH_HEADER)).load(std::memory_order_relaxed);
+}
+
+static void lept_hash_cache_store(const void* e, uint64_t h){
+    std::atomic_ref<uint64_t>(*(uint64_t*)((char*)e - LEPT_HASH_HEADER)).store(h, std::memory_order_relaxed);
+}
+
 // ws = *(%x20 / %x09 / %x0A / %x0D )
 static void lept_parse_whitespace(lept_context* c){
     const char* p = c->json;
@@ -68,30 +115,38 @@ static int lept_parse_ntf(lept_context* c, lept_value* v, const char* flag, lept
 }
 
 // JSON-number = number, int, frac, exp
-static int lept_parse_number(lept_context* c, lept_value* v){
-    // 这里只是起检查作用->strtod可以应付转换
-    auto check_fir_num = [](const char* one){ return *one>='1' && *one<='9' ? 0 : 1; };
-    auto check_mid_num = [](const char* one){ return *one>='0' && *one<='9' ? 0 : 1; };
-    const char* p = c->json;
-    // 不需要每个return前面都要有type和json的设置->当返回invalid_value时就相当于报错
+// 只检查数字的格式，合法时返回数字后面的位置、不合法返回NULL（跳过值的时候不需要strtod）
+// end是输入的结尾；以'\0'结尾的输入传NULL
+static const char* lept_check_number(const char* p, const char* end){
+    auto check_fir_num = [end](const char* one){ return one != end && *one>='1' && *one<='9' ? 0 : 1; };
+    auto check_mid_num = [end](const char* one){ return one != end && *one>='0' && *one<='9' ? 0 : 1; };
+    if (p == end) return NULL;
     if (*p == '-') p++;
     // TODO 这里的条件其实是：单个0(只有一个数字且为0)或开头为1-9的数字！
-    if (*p == '0') p++;
+    if (p != end && *p == '0') p++;
     else { 
-        if(check_fir_num(p)) return LEPT_PARSE_INVALID_VALUE;   // 排除0123这种格式
+        if(check_fir_num(p)) return NULL;   // 排除0123这种格式
         for(p++; check_mid_num(p) != 1; p++);   // 把小数点前的数都略过
     }
-    if (*p == '.') {
+    if (p != end && *p == '.') {
         p++;
-        if (check_mid_num(p)) return LEPT_PARSE_INVALID_VALUE;
+        if (check_mid_num(p)) return NULL;
         for (p++; check_mid_num(p) != 1; p++);
     }
-    if (*p == 'e' || *p == 'E') {
+    if (p != end && (*p == 'e' || *p == 'E')) {
         p++;
-        if (*p == '+' || *p == '-') p++;
-        if (check_mid_num(p)) return LEPT_PARSE_INVALID_VALUE;  // 如果后面e后面没有幂则报错无效
+        if (p != end && (*p == '+' || *p == '-')) p++;
+        if (check_mid_num(p)) return NULL;  // 如果后面e后面没有幂则报错无效
         for (p++; check_mid_num(p) != 1; p++);
-    }   
+    }
+    return p;
+}
+
+static int lept_parse_number(lept_context* c, lept_value* v){
+    // 这里只是起检查作用->strtod可以应付转换
+    const char* p = lept_check_number(c->json, NULL);
+    // 不需要每个return前面都要有type和json的设置->当返回invalid_value时就相当于报错
+    if (p == NULL) return LEPT_PARSE_INVALID_VALUE;
     v->n = strtod(c->json, NULL);   // 这里借用标准库中的函数，使十进制转二进制
     if (v->n == HUGE_VAL || v->n == -HUGE_VAL) return LEPT_PARSE_NUMBER_TOO_BIG;
     // 要清空c的json: 不然要么出现野指针、要么不满足v!=NULL && v->type == MY_NUMBER 
@@ -113,31 +168,38 @@ void lept_free(lept_value* v){
         v->n = 0;
         break;
     case MY_ARRAY:
-        for (i=0; i<v->arrSize; ++i){
-            lept_free(&(v->e[i]));
-        }
+        if (v->arrKind == LEPT_ARRAY_VALUES)
+            for (i=0; i<v->arrSize; ++i){
+                lept_free(&(v->e[i]));
+            }
         // if (v->arrSize != 0) v->arrSize--;
-        free(v->e);
+        lept_elements_free(v->e);
         break;
     case MY_OBJECT:
         for (i=0; i<v->objSize; ++i){
             lept_free(&v->m[i].v);
-            free(v->m->k);
-            v->m->klen = 0;
-            // lept_free(&(v->m[i]));
+            free(v->m[i].k);
         }
-        free(v->m);
+        lept_elements_free(v->m);
     default: break;
     }
     // v->type = MY_NULL;
 }
 
 // 读取16进制的四位；return null来说明格式（范围->不能有G、字符长度）不合法
-static const char* lept_parse_hex4(const char* p, unsigned* u) {
-    if (!((*p>='0' && *p<='9') || (*p>='A' && *p<='F') || (*p>='a' && *p<='f'))) return NULL;
-    char* end;
-    *u = (unsigned)strtol(p, &end, 16);
-    return end == p + 4 ? end : NULL;
+// 正好读4位：strtol会把后面紧跟的十六进制字符也吃掉（比如"\u00e9a"）；end的意思同lept_check_number
+static const char* lept_parse_hex4(const char* p, const char* end, unsigned* u) {
+    *u = 0;
+    for (int i = 0; i < 4; ++i, ++p) {
+        if (p == end) return NULL;
+        char ch = *p;
+        *u <<= 4;
+        if      (ch >= '0' && ch <= '9') *u |= ch - '0';
+        else if (ch >= 'A' && ch <= 'F') *u |= ch - ('A' - 10);
+        else if (ch >= 'a' && ch <= 'f') *u |= ch - ('a' - 10);
+        else return NULL;
+    }
+    return p;
 }
 
 // 检查编码是否正确：计算后查看范围
@@ -198,14 +260,14 @@ static int lept_parse_str_raw(lept_context* c, char** str, size_t* len){
                     case 't':  PUTC(c, '\t'); break;
                     case 'u':
                         // 先检查后压栈
-                        if (!(p = lept_parse_hex4(p, &u)))
+                        if (!(p = lept_parse_hex4(p, NULL, &u)))
                             STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
                         if (u >= 0xD800 && u <= 0xDBFF) { /* surrogate pair */
                             if (*p++ != '\\')
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
                             if (*p++ != 'u')
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
-                            if (!(p = lept_parse_hex4(p, &u2)))
+                            if (!(p = lept_parse_hex4(p, NULL, &u2)))
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_HEX);
                             if (u2 < 0xDC00 || u2 > 0xDFFF)
                                 STRING_ERROR(LEPT_PARSE_INVALID_UNICODE_SURROGATE);
@@ -227,9 +289,8 @@ static int lept_parse_str_raw(lept_context* c, char** str, size_t* len){
             c->top = head;
             return LEPT_PARSE_MISS_QUOTATION_MARK;
         default:
-            if ((unsigned char)ch < 0x20){
-                return LEPT_PARSE_INVALID_STRING_CHAR;
-            }
+            if ((unsigned char)ch < 0x20)
+                STRING_ERROR(LEPT_PARSE_INVALID_STRING_CHAR);
             PUTC(c, ch);
         }
     }
@@ -244,17 +305,87 @@ static int lept_parse_str(lept_context* c, lept_value* v) {
     return ret;
 }
 
+// 栈顶的size个double就地展开成lept_value：lept_value更大，所以从后往前写才不会覆盖还没读的double
+static void lept_unpack_stack(lept_context* c, size_t size){
+    size_t base = c->top - size * sizeof(double);
+    lept_value* e;
+    double* d;
+    if (size == 0)
+        return;
+    lept_context_push(c, size * (sizeof(lept_value) - sizeof(double)));
+    d = (double*)(c->stack + base);
+    e = (lept_value*)(c->stack + base);
+    for (size_t i = size; i-- > 0; ){
+        double n = d[i];
+        e[i].type = MY_NUMBER;
+        e[i].n = n;
+    }
+}
+
+// 数组元素压栈：要求紧凑存储且全是数字的时候只压double（packed为1），遇到第一个不是数字的再把前面的展开成lept_value
+static void lept_push_element(lept_context* c, const lept_value* e, size_t size, int* packed){
+    if (c->pack && e->type == MY_NUMBER && (*packed || size == 0)) {
+        *packed = 1;
+        memcpy(lept_context_push(c, sizeof(double)), &e->n, sizeof(double));
+        return;
+    }
+    if (*packed) {
+        lept_unpack_stack(c, size);
+        *packed = 0;
+    }
+    memcpy(lept_context_push(c, sizeof(lept_value)), e, sizeof(lept_value));
+}
+
+// 把栈顶的size个元素弹出来做成数组v（数组的递归解析和分段解析共用）
+static void lept_pop_array(lept_context* c, lept_value* v, size_t size, int packed){
+    v->type = MY_ARRAY;
+    v->arrKind = packed ? LEPT_ARRAY_NUMBERS : LEPT_ARRAY_VALUES;
+    v->arrSize = size;
+    v->e = NULL;
+    if (size > 0) {
+        size *= packed ? sizeof(double) : sizeof(lept_value);
+        memcpy(v->e = (lept_value*)lept_elements_alloc(size), lept_context_pop(c, size), size);  // 把栈回复到解析当前元素之前，同时给v->e赋值
+    }
+}
+
+static void lept_pop_object(lept_context* c, lept_value* v, size_t size){
+    v->type = MY_OBJECT;
+    v->objSize = size;
+    v->m = NULL;
+    if (size > 0) {
+        size *= sizeof(lept_member);
+        memcpy(v->m = (lept_member*)lept_elements_alloc(size), lept_context_pop(c, size), size);
+    }
+}
+
+// 出错时：把已经压栈的size个元素弹出来释放掉
+static void lept_drop_array(lept_context* c, size_t size, int packed){
+    if (packed) {
+        lept_context_pop(c, size * sizeof(double));
+        return;
+    }
+    for(size_t i=0; i<size; ++i){
+        lept_free((lept_value*)lept_context_pop(c, sizeof(lept_value)));
+    }
+}
+
+static void lept_drop_object(lept_context* c, size_t size){
+    for(size_t i=0; i<size; ++i){
+        lept_member* p = (lept_member*)lept_context_pop(c, sizeof(lept_member));
+        free(p->k);
+        lept_free(&p->v);
+    }
+}
+
 static int lept_parse_value(lept_context* c, lept_value* v);
 static int lept_parse_array(lept_context *c, lept_value *v){
     size_t size = 0;
-    int ret;
+    int ret, packed = 0;
     EXPECT(c, '[');
     lept_parse_whitespace(c);
     if (*c->json == ']') {
         c->json++;
-        v->type = MY_ARRAY;
-        v->arrSize = 0;
-        v->e = NULL;
+        lept_pop_array(c, v, 0, 0);
         return LEPT_PARSE_OK;
     }
     for (;;){
@@ -263,8 +394,7 @@ static int lept_parse_array(lept_context *c, lept_value *v){
         if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK) {
             break; // 这里是break，跳出循环后统一弹栈并返回错误码
         }
-        // TODO 这里memcpy不能省略：
-        memcpy(lept_context_push(c, sizeof(lept_value)), &e, sizeof(lept_value));
+        lept_push_element(c, &e, size, &packed);
         size++;
         lept_parse_whitespace(c);   // 每个元素后且'，'前可以有空格
         if (*c->json == ',') {
@@ -273,10 +403,7 @@ static int lept_parse_array(lept_context *c, lept_value *v){
         }
         else if (*c->json == ']'){
             c->json++;
-            v->type = MY_ARRAY;
-            v->arrSize = size;
-            size *= sizeof(lept_value);
-            memcpy(v->e = (lept_value*)malloc(size), lept_context_pop(c, size), size);  // 把栈回复到解析当前元素之前，同时给v->e赋值
+            lept_pop_array(c, v, size, packed);
             return LEPT_PARSE_OK;
         }else {
             // 要是在这里弹栈会漏掉成功解析的数据
@@ -285,9 +412,20 @@ static int lept_parse_array(lept_context *c, lept_value *v){
         }
     }
     // 这里弹的是单个元素，因为在parse_array和parse_value相互调用过程中，每一组parse_value+parse_array都对应一个数组元素
-    for(size_t i=0; i<size; ++i){
-        lept_free((lept_value*)lept_context_pop(c, sizeof(lept_value)));
-    }
+    lept_drop_array(c, size, packed);
+    return ret;
+}
+
+// 对象的键：和字符串值一样在钩子里计时（键很多的时候字符串的耗时才不会偏少），但不算进nodes
+static int lept_parse_key(lept_context* c, char** str, size_t* len){
+    lept_parse_stats* st;
+    int ret;
+    if (!STATS_ON(c) || c->stats->hook == NULL)
+        return lept_parse_str_raw(c, str, len);
+    st = c->stats;
+    st->hook(st->ud, MY_STRING, 0);
+    ret = lept_parse_str_raw(c, str, len);
+    st->hook(st->ud, MY_STRING, 1);
     return ret;
 }
 
@@ -299,9 +437,7 @@ static int lept_parse_object(lept_context* c, lept_value* v){
     lept_parse_whitespace(c);
     if (*c->json == '}') {
         c->json++;
-        v->type = MY_OBJECT;
-        v->m = 0;
-        v->objSize = 0;
+        lept_pop_object(c, v, 0);
         return LEPT_PARSE_OK;
     }
     m.k = NULL;
@@ -315,16 +451,19 @@ static int lept_parse_object(lept_context* c, lept_value* v){
             break;
         }
         // 这里只借用了解析str的一部分, 解析键
-        if (ret = lept_parse_str_raw(c, &str, &m.klen) != LEPT_PARSE_OK){
+        if ((ret = lept_parse_key(c, &str, &m.klen)) != LEPT_PARSE_OK){
             break;
         }
+        // str指向弹出的栈空间、后面解析值的时候会被覆盖，所以要拷一份
+        memcpy(m.k = (char*)malloc(m.klen + 1), str, m.klen);
+        m.k[m.klen] = '\0';
         // 解析下冒号
         lept_parse_whitespace(c);
         if (*c->json != ':') {
             ret = LEPT_PARSE_MISS_COLON;
             break;
         }
-        else *c->json++;
+        else c->json++;
         lept_parse_whitespace(c);
         // 解析值
         if((ret = lept_parse_value(c, &m.v)) != LEPT_PARSE_OK){
@@ -340,12 +479,8 @@ static int lept_parse_object(lept_context* c, lept_value* v){
             c->json++;
             lept_parse_whitespace(c);
         } else if (*c->json == '}'){
-            size_t s = sizeof(lept_member) * size;
             c->json++;
-            v->arrSize += size;
-            v->type = MY_OBJECT;
-            size *= sizeof(lept_member);
-            memcpy(v->m = (lept_member *)malloc(s), lept_context_pop(c, s), s);
+            lept_pop_object(c, v, size);
             return LEPT_PARSE_OK;
         } else{
             ret = LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
@@ -354,14 +489,12 @@ static int lept_parse_object(lept_context* c, lept_value* v){
         lept_parse_whitespace(c); 
     }
     free(m.k);
-    for(size_t i=0; i<size; ++i){
-        lept_free((lept_value*)lept_context_pop(c, sizeof(lept_member))); // are U sure?
-    }
+    lept_drop_object(c, size);
     return ret;
 }
 
 // value = null / false / true / number ：json数据解析
-static int lept_parse_value(lept_context* c, lept_value* v){
+static int lept_parse_value_raw(lept_context* c, lept_value* v){
     switch (*c->json){
         case '{': return lept_parse_object(c, v);
         case '[': return lept_parse_array(c, v);
@@ -374,15 +507,77 @@ static int lept_parse_value(lept_context* c, lept_value* v){
     }
 }
 
+// 带统计的lept_parse_value：计数、记录深度，并在字符串、数字、数组、对象前后调用钩子
+static int lept_parse_value(lept_context* c, lept_value* v){
+    lept_parse_stats* st;
+    lept_type t;
+    int ret;
+    if (!STATS_ON(c))
+        return lept_parse_value_raw(c, v);
+    st = c->stats;
+    switch (*c->json){
+        case '{': t = MY_OBJECT; break;
+        case '[': t = MY_ARRAY; break;
+        case '"': t = MY_STRING; break;
+        case 'n': case 't': case 'f': case '\0': t = MY_NULL; break;    // 字面量不计时
+        default: t = MY_NUMBER; break;
+    }
+    if (t == MY_ARRAY || t == MY_OBJECT) {
+        if (++c->depth > st->maxDepth)
+            st->maxDepth = c->depth;
+    }
+    if (st->hook != NULL && t != MY_NULL)
+        st->hook(st->ud, t, 0);
+    ret = lept_parse_value_raw(c, v);
+    if (st->hook != NULL && t != MY_NULL)
+        st->hook(st->ud, t, 1);
+    if (t == MY_ARRAY || t == MY_OBJECT)
+        c->depth--;
+    if (ret == LEPT_PARSE_OK) {
+        st->nodes[v->type]++;
+        // 字符串、非空数组、非空对象各malloc一次，对象的每个键再各一次
+        if (v->type == MY_STRING || (v->type == MY_ARRAY && v->e != NULL) || (v->type == MY_OBJECT && v->m != NULL))
+            st->allocs++;
+        if (v->type == MY_OBJECT)
+            st->allocs += v->objSize;
+    }
+    return ret;
+}
+
 /* 封装可以类比接口、放到手机充电器上就是手机要有个插口、充电器也要有个type-C插头（封装会有两部分，一个是对内、一个对外）*/
 // 对外的接口：解析器！
 int lept_parse(lept_value* v, const char* json){
+    return lept_parse_with_stats(v, json, NULL);
+}
+
+static int lept_parse_root(lept_value* v, const char* json, lept_parse_stats* stats, int pack);
+
+int lept_parse_packed(lept_value* v, const char* json){
+    return lept_parse_root(v, json, NULL, 1);
+}
+
+// stats里除了hook和ud，其余字段都会先清零
+int lept_parse_with_stats(lept_value* v, const char* json, lept_parse_stats* stats){
+    return lept_parse_root(v, json, stats, 0);
+}
+
+static int lept_parse_root(lept_value* v, const char* json, lept_parse_stats* stats, int pack){
     lept_context c;
     int ret = 0;
     assert(v != NULL);
     c.json = json;
     c.stack = NULL;
     c.size = c.top = 0;
+    c.stats = stats;
+    c.depth = 0;
+    c.pack = pack;
+    if (stats != NULL) {
+        void (*hook)(void*, lept_type, int) = stats->hook;
+        void* ud = stats->ud;
+        memset(stats, 0, sizeof(*stats));
+        stats->hook = hook;
+        stats->ud = ud;
+    }
     v->type = MY_NULL;
     lept_parse_whitespace(&c);
     // 终止是用'\0'来判断的，也就是解释器从前往后读到换行
@@ -390,94 +585,1945 @@ int lept_parse(lept_value* v, const char* json){
         lept_parse_whitespace(&c);
         // 解析完的反馈是ret，如果c此时未读完，就说明用户传了多个值
         if (*c.json != '\0'){
+            lept_free(v);
             v->type = MY_NULL;
             ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
         }
     }
+    if (stats != NULL)
+        stats->bytes = (size_t)(c.json - json);
     assert(c.top == 0);
     free(c.stack);
     return ret;
 }
 
-// 对外的接口:先得到类型
-lept_type lept_get_type(const lept_value* v){
-    assert(v != NULL);
-    return v->type;
+// 分段解析：递归换成显式的栈，每一层数组/对象在栈上有一个帧头，后面跟着它已经解析好的元素
+typedef struct{
+    size_t parent;      // 上一层帧头在栈里的偏移
+    size_t size;        // 已经压栈的元素个数
+    lept_type type;     // MY_ARRAY / MY_OBJECT
+    int packed;         // 数组：目前压的都是double
+    char* k;            // 对象：正在解析的成员的键
+    size_t klen;
+}lept_frame;
+
+enum{
+    LEPT_STEP_VALUE,    // 等一个值
+    LEPT_STEP_KEY,      // 等对象的键
+    LEPT_STEP_NEXT,     // 刚解析完一个元素，等','或者右括号
+    LEPT_STEP_DONE
+};
+
+void lept_parser_init(lept_parser* p, lept_value* v, const char* json){
+    assert(p != NULL && v != NULL && json != NULL);
+    p->v = v;
+    p->json = json;
+    p->stack = NULL;
+    p->size = p->top = 0;
+    p->frame = 0;
+    p->depth = 0;
+    p->state = LEPT_STEP_VALUE;
+    p->packNumbers = 0;
+    v->type = MY_NULL;
 }
 
-// 先按照b=1时v为true、b=0时v为false算
-void lept_set_bool(lept_value* v, int b){
-    lept_free(v);
-    v->type = b==1 ? MY_TRUE : MY_FALSE;
+static lept_frame* lept_parser_frame(lept_context* c, size_t frame){
+    return (lept_frame*)(c->stack + frame);
 }
 
-int lept_get_bool(const lept_value* v){
-    assert(v->type == MY_TRUE || v->type == MY_FALSE);
-    assert(v != NULL);
-    return v->type == MY_TRUE ? 1 : 0;
+// 出错或者中途放弃：从最里层开始把所有帧和已经解析好的元素都释放掉
+static void lept_parser_unwind(lept_parser* p, lept_context* c){
+    lept_frame f;
+    for (; p->depth > 0; p->depth--){
+        memcpy(&f, lept_parser_frame(c, p->frame), sizeof(lept_frame));
+        if (f.type == MY_ARRAY)
+            lept_drop_array(c, f.size, f.packed);
+        else
+            lept_drop_object(c, f.size);
+        free(f.k);
+        lept_context_pop(c, sizeof(lept_frame));
+        p->frame = f.parent;
+    }
 }
 
-// 写入数字
-void lept_set_number(lept_value* v, double n){
-    lept_free(v);
-    // 这里要不要加一个lept_parse_num？不然n不是正常要传进来的东西呢？-< 不需要，因为是在内部的解析器里调用这几个接口的
-    v->n = n;
-    v->type = MY_NUMBER;
+// 一个值解析完了：交给外层的数组/对象，或者就是根
+static int lept_parser_complete(lept_parser* p, lept_context* c, lept_value* e){
+    lept_frame* f;
+    lept_member* m;
+    if (p->depth == 0){
+        *p->v = *e;
+        lept_parse_whitespace(c);
+        if (*c->json != '\0'){
+            lept_free(p->v);
+            p->v->type = MY_NULL;
+            return LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
+        p->state = LEPT_STEP_DONE;
+        return LEPT_PARSE_OK;
+    }
+    f = lept_parser_frame(c, p->frame);
+    if (f->type == MY_ARRAY) {
+        int packed = f->packed;
+        lept_push_element(c, e, f->size, &packed);
+        lept_parser_frame(c, p->frame)->packed = packed;
+    }
+    else {
+        m = (lept_member*)lept_context_push(c, sizeof(lept_member));
+        f = lept_parser_frame(c, p->frame);     // push可能realloc，所以帧头要在push之后再取
+        m->k = f->k;
+        m->klen = f->klen;
+        m->v = *e;
+        f->k = NULL;
+    }
+    lept_parser_frame(c, p->frame)->size++;
+    p->state = LEPT_STEP_NEXT;
+    return LEPT_PARSE_OK;
 }
 
-// 得到数字
-double lept_get_number(const lept_value* v) {
-    assert(v != NULL && v->type == MY_NUMBER);
-    return v->n;
+// 进入一层数组/对象
+static int lept_parser_open(lept_parser* p, lept_context* c, lept_type type){
+    lept_frame* f;
+    lept_value e;
+    size_t frame = c->top;
+    c->json++;
+    lept_parse_whitespace(c);
+    if (*c->json == (type == MY_ARRAY ? ']' : '}')){
+        c->json++;
+        if (type == MY_ARRAY) lept_pop_array(c, &e, 0, 0);
+        else lept_pop_object(c, &e, 0);
+        return lept_parser_complete(p, c, &e);
+    }
+    f = (lept_frame*)lept_context_push(c, sizeof(lept_frame));
+    f->parent = p->frame;
+    f->size = 0;
+    f->type = type;
+    f->packed = 0;
+    f->k = NULL;
+    f->klen = 0;
+    p->frame = frame;
+    p->depth++;
+    p->state = type == MY_ARRAY ? LEPT_STEP_VALUE : LEPT_STEP_KEY;
+    return LEPT_PARSE_OK;
 }
 
-// TODO 这里要先cp一份str，既然是动态分配，cpp可以智能指针什么的把？
-void lept_set_str(lept_value* v, const char* s, size_t len){
-    assert(v != NULL && (s != NULL || len == 0));
-    lept_free(v);
-    v->s = (char*)malloc(len + 1);
-    memcpy(v->s, s, len);
-    v->s[len] = '\0';
-    v->len = len;
-    v->type = MY_STRING;
+// 离开一层：弹出元素做成值，再弹出帧头
+static int lept_parser_close(lept_parser* p, lept_context* c){
+    lept_frame f;
+    lept_value e;
+    memcpy(&f, lept_parser_frame(c, p->frame), sizeof(lept_frame));
+    c->json++;
+    if (f.type == MY_ARRAY) lept_pop_array(c, &e, f.size, f.packed);
+    else lept_pop_object(c, &e, f.size);
+    lept_context_pop(c, sizeof(lept_frame));
+    p->frame = f.parent;
+    p->depth--;
+    return lept_parser_complete(p, c, &e);
 }
 
-const char* lept_get_str(const lept_value* v) {
-    assert(v != NULL && v->type == MY_STRING);
-    return v->s;
+// 做一步：一个标量、一个键、一个括号或者一个逗号
+static int lept_parser_advance(lept_parser* p, lept_context* c){
+    lept_frame* f;
+    lept_value e;
+    char* str;
+    size_t len;
+    int ret;
+    switch (p->state){
+    case LEPT_STEP_VALUE:
+        lept_parse_whitespace(c);
+        if (*c->json == '[') return lept_parser_open(p, c, MY_ARRAY);
+        if (*c->json == '{') return lept_parser_open(p, c, MY_OBJECT);
+        lept_init(&e);
+        if ((ret = lept_parse_value(c, &e)) != LEPT_PARSE_OK)
+            return ret;
+        return lept_parser_complete(p, c, &e);
+    case LEPT_STEP_KEY:
+        if (*c->json != '"')
+            return LEPT_PARSE_MISS_KEY;
+        if ((ret = lept_parse_str_raw(c, &str, &len)) != LEPT_PARSE_OK)
+            return ret;
+        f = lept_parser_frame(c, p->frame);
+        memcpy(f->k = (char*)malloc(len + 1), str, len);
+        f->k[len] = '\0';
+        f->klen = len;
+        lept_parse_whitespace(c);
+        if (*c->json != ':')
+            return LEPT_PARSE_MISS_COLON;
+        c->json++;
+        lept_parse_whitespace(c);
+        p->state = LEPT_STEP_VALUE;
+        return LEPT_PARSE_OK;
+    case LEPT_STEP_NEXT:
+        lept_parse_whitespace(c);
+        f = lept_parser_frame(c, p->frame);
+        if (*c->json == ','){
+            c->json++;
+            lept_parse_whitespace(c);
+            p->state = f->type == MY_ARRAY ? LEPT_STEP_VALUE : LEPT_STEP_KEY;
+            return LEPT_PARSE_OK;
+        }
+        if (*c->json == (f->type == MY_ARRAY ? ']' : '}'))
+            return lept_parser_close(p, c);
+        return f->type == MY_ARRAY ? LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+    default:
+        assert(0 && "lept_parse_step after done");
+        return LEPT_PARSE_OK;
+    }
 }
 
-size_t lept_get_str_len(const lept_value* v){
-    assert(v != NULL && v->type == MY_STRING);
-    return v->len;
+// 读满max_bytes个字节（至少做一步）就返回LEPT_PARSE_YIELD；单个字符串或数字不会被切开
+int lept_parse_step(lept_parser* p, size_t max_bytes){
+    lept_context c;
+    const char* start = p->json;
+    int ret;
+    assert(p != NULL && p->state != LEPT_STEP_DONE);
+    c.json = p->json;
+    c.stack = p->stack;
+    c.size = p->size;
+    c.top = p->top;
+    c.stats = NULL;
+    c.depth = 0;
+    c.pack = p->packNumbers;
+    do {
+        ret = lept_parser_advance(p, &c);
+    } while (ret == LEPT_PARSE_OK && p->state != LEPT_STEP_DONE && (size_t)(c.json - start) < max_bytes);
+    if (ret != LEPT_PARSE_OK){
+        lept_parser_unwind(p, &c);
+        p->v->type = MY_NULL;
+        p->state = LEPT_STEP_DONE;
+    }
+    p->json = c.json;
+    p->stack = c.stack;
+    p->size = c.size;
+    p->top = c.top;
+    if (p->state != LEPT_STEP_DONE)
+        return LEPT_PARSE_YIELD;
+    assert(p->top == 0);
+    free(p->stack);
+    p->stack = NULL;
+    p->size = 0;
+    return ret;
 }
 
-size_t lept_get_array_size(const lept_value* v) {
-    assert(v != NULL && v->type == MY_ARRAY);
-    return v->arrSize;
+// 没解析完就不要了：释放中间状态，v保持MY_NULL；已经返回过结果的parser调用它什么也不做
+void lept_parser_free(lept_parser* p){
+    lept_context c;
+    assert(p != NULL);
+    if (p->state == LEPT_STEP_DONE)
+        return;
+    c.json = p->json;
+    c.stack = p->stack;
+    c.size = p->size;
+    c.top = p->top;
+    c.stats = NULL;
+    c.depth = 0;
+    c.pack = 0;
+    lept_parser_unwind(p, &c);
+    free(c.stack);
+    p->stack = NULL;
+    p->size = p->top = 0;
+    p->state = LEPT_STEP_DONE;
 }
 
-lept_value* lept_get_array_element(const lept_value* v, size_t index) {
-    assert(v != NULL && v->type == MY_ARRAY);
-    assert(index < v->arrSize);
-    return &v->e[index];
+// 跳过一个值：只检查格式、不生成lept_value（字符串借用栈来解析，用完马上弹掉）
+static int lept_skip_value(lept_context* c){
+    lept_value tmp;
+    char* s;
+    size_t len;
+    int ret;
+    switch (*c->json){
+        case 'n': return lept_parse_ntf(c, &tmp, "null", MY_NULL);
+        case 't': return lept_parse_ntf(c, &tmp, "true", MY_TRUE);
+        case 'f': return lept_parse_ntf(c, &tmp, "false", MY_FALSE);
+        case '"': return lept_parse_str_raw(c, &s, &len);
+        case '\0': return LEPT_PARSE_EXPECT_VALUE;
+        case '[':
+            c->json++;
+            lept_parse_whitespace(c);
+            if (*c->json == ']') { c->json++; return LEPT_PARSE_OK; }
+            for (;;){
+                if ((ret = lept_skip_value(c)) != LEPT_PARSE_OK) return ret;
+                lept_parse_whitespace(c);
+                if (*c->json == ']') { c->json++; return LEPT_PARSE_OK; }
+                if (*c->json != ',') return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                c->json++;
+                lept_parse_whitespace(c);
+            }
+        case '{':
+            c->json++;
+            lept_parse_whitespace(c);
+            if (*c->json == '}') { c->json++; return LEPT_PARSE_OK; }
+            for (;;){
+                if (*c->json != '\"') return LEPT_PARSE_MISS_KEY;
+                if ((ret = lept_parse_str_raw(c, &s, &len)) != LEPT_PARSE_OK) return ret;
+                lept_parse_whitespace(c);
+                if (*c->json != ':') return LEPT_PARSE_MISS_COLON;
+                c->json++;
+                lept_parse_whitespace(c);
+                if ((ret = lept_skip_value(c)) != LEPT_PARSE_OK) return ret;
+                lept_parse_whitespace(c);
+                if (*c->json == '}') { c->json++; return LEPT_PARSE_OK; }
+                if (*c->json != ',') return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                c->json++;
+                lept_parse_whitespace(c);
+            }
+        default:
+            if ((s = (char*)lept_check_number(c->json, NULL)) == NULL) return LEPT_PARSE_INVALID_VALUE;
+            c->json = s;
+            return LEPT_PARSE_OK;
+    }
 }
 
-size_t lept_get_object_size(const lept_value* v){
-    assert(v != NULL && v->type == MY_OBJECT);
-    return v->objSize;
+// 值的类型和字段对不上：先把值跳过（格式错误优先报出来），再报类型不匹配
+static int lept_skip_mismatch(lept_context* c){
+    int ret = lept_skip_value(c);
+    return ret == LEPT_PARSE_OK ? LEPT_PARSE_TYPE_MISMATCH : ret;
 }
 
-const char* lept_get_object_key(const lept_value* v, size_t index){
-    assert(v != NULL && index>=0 && v->type == MY_OBJECT);
-    return v->m[index].k;
+// 找键对应的字段：有哈希表时只看一个槽；没有时消息里的键一般和声明顺序一致，所以先试hint指向的下一个字段
+static const lept_field* lept_find_field(const lept_field* fields, size_t n, const lept_field_index* index, const char* k, size_t klen, size_t* hint){
+    size_t i, j;
+    if (index != NULL){
+        i = index->slots[lept_field_hash(k, klen, index->seed) & index->mask];
+        if (i != 0 && fields[i - 1].klen == klen && memcmp(fields[i - 1].k, k, klen) == 0)
+            return &fields[i - 1];
+        return NULL;
+    }
+    for (i = 0; i < n; ++i){
+        j = *hint + i < n ? *hint + i : *hint + i - n;
+        if (fields[j].klen == klen && memcmp(fields[j].k, k, klen) == 0){
+            *hint = j + 1 < n ? j + 1 : 0;
+            return &fields[j];
+        }
+    }
+    return NULL;
 }
 
-size_t lept_get_object_key_length(const lept_value* v, size_t index){
-    assert(v != NULL && v->type == MY_OBJECT && index>=0);
-    return v->m[index].klen;
+static int lept_parse_fields_object(lept_context* c, char* obj, const lept_field* fields, size_t n, const lept_field_index* index);
+
+// long long不能经过double：超过2^53的整数double表示不了，会被悄悄改成相邻的偶数
+// 没有小数和指数时直接按整数读；否则只接受2^53以下的整数
+static int lept_parse_int64(lept_context* c, long long* dst){
+    const char* p = lept_check_number(c->json, NULL);
+    const char* q;
+    long long i;
+    double n;
+    if (p == NULL) return LEPT_PARSE_INVALID_VALUE;
+    for (q = c->json; q != p && *q != '.' && *q != 'e' && *q != 'E'; ++q);
+    if (q == p){
+        errno = 0;
+        i = strtoll(c->json, NULL, 10);
+        c->json = p;
+        if (errno == ERANGE) return LEPT_PARSE_TYPE_MISMATCH;
+        *dst = i;
+        return LEPT_PARSE_OK;
+    }
+    n = strtod(c->json, NULL);
+    if (n == HUGE_VAL || n == -HUGE_VAL) return LEPT_PARSE_NUMBER_TOO_BIG;
+    c->json = p;
+    if (fabs(n) >= 9007199254740992.0 || n != (long long)n) return LEPT_PARSE_TYPE_MISMATCH;   // 2^53也可能是舍入来的
+    *dst = (long long)n;
+    return LEPT_PARSE_OK;
+}
+
+static int lept_parse_field(lept_context* c, char* dst, const lept_field* f){
+    lept_value tmp;
+    char* s;
+    size_t len;
+    int ret;
+    // null表示没有这个值，字段保持原样
+    if (*c->json == 'n')
+        return lept_parse_ntf(c, &tmp, "null", MY_NULL);
+    switch (f->kind){
+    case LEPT_FIELD_NUMBER:
+    case LEPT_FIELD_INT:
+        if (*c->json != '-' && (*c->json < '0' || *c->json > '9'))
+            return lept_skip_mismatch(c);
+        if ((ret = lept_parse_number(c, &tmp)) != LEPT_PARSE_OK)
+            return ret;
+        if (f->kind == LEPT_FIELD_NUMBER)
+            *(double*)dst = tmp.n;
+        else {
+            if (tmp.n < INT_MIN || tmp.n > INT_MAX || tmp.n != (int)tmp.n) return LEPT_PARSE_TYPE_MISMATCH;
+            *(int*)dst = (int)tmp.n;
+        }
+        return LEPT_PARSE_OK;
+    case LEPT_FIELD_INT64:
+        if (*c->json != '-' && (*c->json < '0' || *c->json > '9'))
+            return lept_skip_mismatch(c);
+        return lept_parse_int64(c, (long long*)dst);
+    case LEPT_FIELD_BOOL:
+        if (*c->json == 't') ret = lept_parse_ntf(c, &tmp, "true", MY_TRUE);
+        else if (*c->json == 'f') ret = lept_parse_ntf(c, &tmp, "false", MY_FALSE);
+        else return lept_skip_mismatch(c);
+        if (ret == LEPT_PARSE_OK)
+            *(bool*)dst = tmp.type == MY_TRUE;
+        return ret;
+    case LEPT_FIELD_STRING:
+        if (*c->json != '"')
+            return lept_skip_mismatch(c);
+        if ((ret = lept_parse_str_raw(c, &s, &len)) == LEPT_PARSE_OK)
+            f->set_str(dst, s, len);
+        return ret;
+    case LEPT_FIELD_OBJECT:
+        if (*c->json != '{')
+            return lept_skip_mismatch(c);
+        return lept_parse_fields_object(c, dst, f->sub, f->subSize, f->subIndex);
+    default:
+        assert(0 && "invalid field kind");
+        return LEPT_PARSE_INVALID_VALUE;
+    }
+}
+
+// 和lept_parse_object的语法一样，只是值直接写进结构体里
+static int lept_parse_fields_object(lept_context* c, char* obj, const lept_field* fields, size_t n, const lept_field_index* index){
+    const lept_field* f;
+    char* k;
+    size_t klen, hint = 0;
+    int ret;
+    EXPECT(c, '{');
+    lept_parse_whitespace(c);
+    if (*c->json == '}') {
+        c->json++;
+        return LEPT_PARSE_OK;
+    }
+    for (;;){
+        if (*c->json != '\"')
+            return LEPT_PARSE_MISS_KEY;
+        if ((ret = lept_parse_str_raw(c, &k, &klen)) != LEPT_PARSE_OK)
+            return ret;
+        // k指向已经弹出的栈空间，下一次PUTC就会覆盖它，所以要马上查
+        f = lept_find_field(fields, n, index, k, klen, &hint);
+        lept_parse_whitespace(c);
+        if (*c->json != ':')
+            return LEPT_PARSE_MISS_COLON;
+        c->json++;
+        lept_parse_whitespace(c);
+        ret = f != NULL ? lept_parse_field(c, obj + f->offset, f) : lept_skip_value(c);
+        if (ret != LEPT_PARSE_OK)
+            return ret;
+        lept_parse_whitespace(c);
+        if (*c->json == '}'){
+            c->json++;
+            return LEPT_PARSE_OK;
+        }
+        if (*c->json != ',')
+            return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        c->json++;
+        lept_parse_whitespace(c);
+    }
+}
+
+// 对外的接口：解析进结构体
+int lept_parse_fields(void* obj, const lept_field* fields, size_t n, const lept_field_index* index, const char* json){
+    lept_context c;
+    int ret;
+    assert(obj != NULL && (fields != NULL || n == 0) && json != NULL);
+    c.json = json;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.stats = NULL;
+    c.depth = 0;
+    c.pack = 0;
+    lept_parse_whitespace(&c);
+    if (*c.json == '{')
+        ret = lept_parse_fields_object(&c, (char*)obj, fields, n, index);
+    else if (*c.json == '\0')
+        ret = LEPT_PARSE_EXPECT_VALUE;
+    else
+        ret = lept_skip_mismatch(&c);
+    if (ret == LEPT_PARSE_OK){
+        lept_parse_whitespace(&c);
+        if (*c.json != '\0')
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+    }
+    assert(c.top == 0);
+    free(c.stack);
+    return ret;
+}
+
+// 按列提取
+#ifndef LEPT_COLUMN_INIT_ROWS
+#define LEPT_COLUMN_INIT_ROWS 64
+#endif
+
+#define BIT_SET(bits, i)   ((bits)[(i) >> 3] |= (unsigned char)(1u << ((i) & 7)))
+#define BIT_CLEAR(bits, i) ((bits)[(i) >> 3] &= (unsigned char)~(1u << ((i) & 7)))
+
+static void lept_column_reset(lept_column* col){
+    col->valid = NULL;
+    col->numbers = NULL;
+    col->bools = NULL;
+    col->offsets = NULL;
+    col->chars = NULL;
+    col->capacity = col->charsSize = col->charsCapacity = 0;
+}
+
+void lept_free_columns(lept_column* cols, size_t n){
+    assert(cols != NULL || n == 0);
+    for (size_t i = 0; i < n; ++i){
+        free(cols[i].valid);
+        free(cols[i].numbers);
+        free(cols[i].bools);
+        free(cols[i].offsets);
+        free(cols[i].chars);
+        lept_column_reset(&cols[i]);
+    }
+}
+
+// 给每一列加一行空值（无效），之后遇到字段再填
+static void lept_columns_add_row(lept_column* cols, size_t n, size_t row){
+    for (size_t i = 0; i < n; ++i){
+        lept_column* col = &cols[i];
+        if (row == col->capacity){
+            size_t old = (col->capacity + 7) >> 3;
+            col->capacity = col->capacity == 0 ? LEPT_COLUMN_INIT_ROWS : col->capacity + (col->capacity >> 1);
+            col->valid = (unsigned char*)realloc(col->valid, (col->capacity + 7) >> 3);
+            memset(col->valid + old, 0, ((col->capacity + 7) >> 3) - old);
+            switch (col->type){
+            case LEPT_COLUMN_NUMBER:
+                col->numbers = (double*)realloc(col->numbers, col->capacity * sizeof(double));
+                break;
+            case LEPT_COLUMN_BOOL:
+                col->bools = (unsigned char*)realloc(col->bools, (col->capacity + 7) >> 3);
+                memset(col->bools + old, 0, ((col->capacity + 7) >> 3) - old);
+                break;
+            case LEPT_COLUMN_STRING:
+                col->offsets = (size_t*)realloc(col->offsets, (col->capacity + 1) * sizeof(size_t));
+                break;
+            }
+        }
+        if (col->type == LEPT_COLUMN_NUMBER)
+            col->numbers[row] = 0.0;
+        else if (col->type == LEPT_COLUMN_STRING)
+            col->offsets[row + 1] = col->offsets[row];
+    }
+}
+
+static int lept_column_set(lept_context* c, lept_column* col, size_t row){
+    lept_value tmp;
+    char* s;
+    size_t len;
+    int ret;
+    // 同一行里键重复时后面的覆盖前面的：字符串是这一列最后写的，直接退回到这一行的开头
+    BIT_CLEAR(col->valid, row);
+    if (col->type == LEPT_COLUMN_STRING)
+        col->charsSize = col->offsets[row + 1] = col->offsets[row];
+    if (*c->json == 'n')
+        return lept_parse_ntf(c, &tmp, "null", MY_NULL);
+    switch (col->type){
+    case LEPT_COLUMN_NUMBER:
+        if (*c->json != '-' && (*c->json < '0' || *c->json > '9'))
+            return lept_skip_mismatch(c);
+        if ((ret = lept_parse_number(c, &tmp)) != LEPT_PARSE_OK)
+            return ret;
+        col->numbers[row] = tmp.n;
+        break;
+    case LEPT_COLUMN_BOOL:
+        if (*c->json == 't') ret = lept_parse_ntf(c, &tmp, "true", MY_TRUE);
+        else if (*c->json == 'f') ret = lept_parse_ntf(c, &tmp, "false", MY_FALSE);
+        else return lept_skip_mismatch(c);
+        if (ret != LEPT_PARSE_OK)
+            return ret;
+        if (tmp.type == MY_TRUE) BIT_SET(col->bools, row);
+        else BIT_CLEAR(col->bools, row);
+        break;
+    case LEPT_COLUMN_STRING:
+        if (*c->json != '"')
+            return lept_skip_mismatch(c);
+        if ((ret = lept_parse_str_raw(c, &s, &len)) != LEPT_PARSE_OK)
+            return ret;
+        if (col->charsSize + len > col->charsCapacity){
+            while (col->charsSize + len > col->charsCapacity)
+                col->charsCapacity = col->charsCapacity == 0 ? LEPT_PARSE_STACK_INIT_SIZE : col->charsCapacity + (col->charsCapacity >> 1);
+            col->chars = (char*)realloc(col->chars, col->charsCapacity);
+        }
+        memcpy(col->chars + col->charsSize, s, len);
+        col->charsSize += len;
+        col->offsets[row + 1] = col->charsSize;
+        break;
+    }
+    BIT_SET(col->valid, row);
+    return LEPT_PARSE_OK;
+}
+
+// 和lept_find_field一样，先试上一次匹配的下一列
+static lept_column* lept_find_column(lept_column* cols, size_t n, const char* k, size_t klen, size_t* hint){
+    size_t i, j;
+    for (i = 0; i < n; ++i){
+        j = *hint + i < n ? *hint + i : *hint + i - n;
+        if (cols[j].nameLen == klen && memcmp(cols[j].name, k, klen) == 0){
+            *hint = j + 1 < n ? j + 1 : 0;
+            return &cols[j];
+        }
+    }
+    return NULL;
+}
+
+// 一条记录：语法和lept_parse_fields_object一样，没要求的字段直接跳过
+static int lept_extract_record(lept_context* c, lept_column* cols, size_t n, size_t row){
+    lept_column* col;
+    char* k;
+    size_t klen, hint = 0;
+    int ret;
+    if (*c->json != '{')
+        return *c->json == '\0' ? LEPT_PARSE_EXPECT_VALUE : lept_skip_mismatch(c);
+    lept_columns_add_row(cols, n, row);
+    c->json++;
+    lept_parse_whitespace(c);
+    if (*c->json == '}') {
+        c->json++;
+        return LEPT_PARSE_OK;
+    }
+    for (;;){
+        if (*c->json != '\"')
+            return LEPT_PARSE_MISS_KEY;
+        if ((ret = lept_parse_str_raw(c, &k, &klen)) != LEPT_PARSE_OK)
+            return ret;
+        col = lept_find_column(cols, n, k, klen, &hint);
+        lept_parse_whitespace(c);
+        if (*c->json != ':')
+            return LEPT_PARSE_MISS_COLON;
+        c->json++;
+        lept_parse_whitespace(c);
+        ret = col != NULL ? lept_column_set(c, col, row) : lept_skip_value(c);
+        if (ret != LEPT_PARSE_OK)
+            return ret;
+        lept_parse_whitespace(c);
+        if (*c->json == '}'){
+            c->json++;
+            return LEPT_PARSE_OK;
+        }
+        if (*c->json != ',')
+            return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        c->json++;
+        lept_parse_whitespace(c);
+    }
+}
+
+static int lept_extract_array(lept_context* c, lept_column* cols, size_t n, size_t* rows){
+    int ret;
+    if (*c->json != '[')
+        return *c->json == '\0' ? LEPT_PARSE_EXPECT_VALUE : lept_skip_mismatch(c);
+    c->json++;
+    lept_parse_whitespace(c);
+    if (*c->json == ']'){
+        c->json++;
+        return LEPT_PARSE_OK;
+    }
+    for (;;){
+        if ((ret = lept_extract_record(c, cols, n, *rows)) != LEPT_PARSE_OK)
+            return ret;
+        ++*rows;
+        lept_parse_whitespace(c);
+        if (*c->json == ']'){
+            c->json++;
+            return LEPT_PARSE_OK;
+        }
+        if (*c->json != ',')
+            return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        c->json++;
+        lept_parse_whitespace(c);
+    }
+}
+
+// NDJSON：每行一条记录，空行跳过，一行里有两个值算ROOT_NOT_SINGULAR
+static int lept_extract_ndjson(lept_context* c, lept_column* cols, size_t n, size_t* rows){
+    int ret;
+    while (*c->json != '\0'){
+        if ((ret = lept_extract_record(c, cols, n, *rows)) != LEPT_PARSE_OK)
+            return ret;
+        ++*rows;
+        while (*c->json == ' ' || *c->json == '\t' || *c->json == '\r')
+            c->json++;
+        if (*c->json != '\n' && *c->json != '\0')
+            return LEPT_PARSE_ROOT_NOT_SINGULAR;
+        lept_parse_whitespace(c);
+    }
+    return LEPT_PARSE_OK;
+}
+
+static int lept_extract(const char* json, lept_column* cols, size_t n, size_t* rows, int ndjson){
+    lept_context c;
+    int ret;
+    assert(json != NULL && (cols != NULL || n == 0) && rows != NULL);
+    c.json = json;
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.stats = NULL;
+    c.depth = 0;
+    c.pack = 0;
+    *rows = 0;
+    for (size_t i = 0; i < n; ++i){
+        lept_column_reset(&cols[i]);
+        // 字符串列总有rows + 1个偏移，一行都没有时也要有offsets[0]
+        if (cols[i].type == LEPT_COLUMN_STRING){
+            cols[i].offsets = (size_t*)malloc(sizeof(size_t));
+            cols[i].offsets[0] = 0;
+        }
+    }
+    lept_parse_whitespace(&c);
+    ret = ndjson ? lept_extract_ndjson(&c, cols, n, rows) : lept_extract_array(&c, cols, n, rows);
+    if (ret == LEPT_PARSE_OK){
+        lept_parse_whitespace(&c);
+        if (*c.json != '\0')
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+    }
+    if (ret != LEPT_PARSE_OK){
+        lept_free_columns(cols, n);
+        *rows = 0;
+    }
+    assert(c.top == 0);
+    free(c.stack);
+    return ret;
+}
+
+int lept_extract_columns(const char* json, lept_column* cols, size_t n, size_t* rows){
+    return lept_extract(json, cols, n, rows, 0);
+}
+
+int lept_extract_columns_ndjson(const char* json, lept_column* cols, size_t n, size_t* rows){
+    return lept_extract(json, cols, n, rows, 1);
+}
+
+// 不建树的检查/压缩：语法和lept_parse一样（错误码也一样），但输入带长度、不分配内存
+typedef struct{
+    const char* p;
+    const char* end;
+    char* out;      // lept_minify的输出，lept_validate时为NULL
+}lept_scanner;
+
+#define SCAN_PEEK(s) ((s)->p != (s)->end ? *(s)->p : '\0')
+#define SCAN_EMIT(s, from, len) do { if ((s)->out) { memcpy((s)->out, (from), (len)); (s)->out += (len); } } while(0)
+
+// 找第一个不是空白的字符：一次比较16个字节
+static const char* lept_scan_whitespace_run(const char* p, const char* end){
+#if defined(__SSE2__)
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    for (; end - p >= 16; p += 16){
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, sp), _mm_cmpeq_epi8(x, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)));
+        int mask = ~_mm_movemask_epi8(ws) & 0xFFFF;
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    return p;
+}
+
+// 找字符串里第一个要特别处理的字符：引号、反斜杠或者控制字符
+static const char* lept_scan_string_run(const char* p, const char* end){
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\'), ctrl = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16){
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        // 无符号的 x <= 0x1F 等价于 max(x, 0x1F) == 0x1F
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, bslash)),
+                                 _mm_cmpeq_epi8(_mm_max_epu8(x, ctrl), ctrl));
+        int mask = _mm_movemask_epi8(m);
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    while (p != end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
+        p++;
+    return p;
+}
+
+static void lept_scan_whitespace(lept_scanner* s){
+    s->p = lept_scan_whitespace_run(s->p, s->end);
+}
+
+// 和lept_parse_str_raw的检查顺序一样，只是不解码，压缩时原样输出
+static int lept_scan_string(lept_scanner* s){
+    const char* start = s->p;
+    const char* p = s->p + 1;
+    const char* end = s->end;
+    unsigned u, u2;
+    for (;;){
+        p = lept_scan_string_run(p, end);
+        if (p == end)
+            return LEPT_PARSE_MISS_QUOTATION_MARK;
+        char ch = *p++;
+        if (ch == '"')
+            break;
+        if ((unsigned char)ch < 0x20)
+            return LEPT_PARSE_INVALID_STRING_CHAR;
+        // 反斜杠
+        switch (p != end ? *p++ : '\0') {
+            case '"': case '\\': case '/':
+            case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                if (!(p = lept_parse_hex4(p, end, &u)))
+                    return LEPT_PARSE_INVALID_UNICODE_HEX;
+                if (u >= 0xD800 && u <= 0xDBFF) {
+                    if (p == end || *p++ != '\\')
+                        return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                    if (p == end || *p++ != 'u')
+                        return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                    if (!(p = lept_parse_hex4(p, end, &u2)))
+                        return LEPT_PARSE_INVALID_UNICODE_HEX;
+                    if (u2 < 0xDC00 || u2 > 0xDFFF)
+                        return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                }
+                break;
+            default:
+                return LEPT_PARSE_INVALID_STRING_ESCAPE;
+        }
+    }
+    SCAN_EMIT(s, start, (size_t)(p - start));
+    s->p = p;
+    return LEPT_PARSE_OK;
+}
+
+#define LEPT_SCAN_NUMBER_DIGITS 320
+
+// 数字：格式检查和lept_parse_number共用；太大的数不用每次都strtod，先估计十进制的量级
+static int lept_scan_number(lept_scanner* s){
+    const char* start = s->p;
+    const char* p = start;
+    const char* end;
+    long mag = -1, e = 0;
+    int nonzero = 0, esign = 1;
+    if ((end = lept_check_number(start, s->end)) == NULL)
+        return LEPT_PARSE_INVALID_VALUE;
+    if (*p == '-') p++;
+    // 量级 = 第一个非零数字的位置 + 指数
+    for (; p != end && *p >= '0' && *p <= '9'; ++p){
+        if (nonzero) mag++;
+        else if (*p != '0') { nonzero = 1; mag = 0; }
+    }
+    if (p != end && *p == '.')
+        for (++p; p != end && *p >= '0' && *p <= '9'; ++p)
+            if (!nonzero) {
+                if (*p != '0') nonzero = 1;
+                else mag--;
+            }
+    if (!nonzero) {
+        mag = 0;    // 0不会溢出
+    }
+    else if (p != end) {
+        p++;    // e/E
+        if (*p == '+' || *p == '-') esign = *p++ == '-' ? -1 : 1;
+        for (; p != end && *p >= '0' && *p <= '9'; ++p)
+            if (e < 100000) e = e * 10 + (*p - '0');
+        mag += esign * e;
+    }
+    if (nonzero && mag > 308)
+        return LEPT_PARSE_NUMBER_TOO_BIG;
+    if (nonzero && mag == 308) {
+        // 在DBL_MAX附近：把有效数字规整成 0.ddd…e309 交给strtod判断
+        // 溢出的分界 2^1024 - 2^970 一共309位有效数字，留够这么多位，后面再有非零数字就补一个1，结果和整段strtod一样
+        char buf[LEPT_SCAN_NUMBER_DIGITS + 8];
+        size_t len = 2;
+        int sticky = 0;
+        buf[0] = '0'; buf[1] = '.';
+        for (p = start; p != end && *p != 'e' && *p != 'E'; ++p){
+            if (*p < '0' || *p > '9' || (len == 2 && *p == '0'))
+                continue;
+            if (len < 2 + LEPT_SCAN_NUMBER_DIGITS)
+                buf[len++] = *p;
+            else if (*p != '0')
+                sticky = 1;
+        }
+        if (sticky)
+            buf[len++] = '1';
+        memcpy(buf + len, "e309", 5);
+        if (strtod(buf, NULL) == HUGE_VAL)
+            return LEPT_PARSE_NUMBER_TOO_BIG;
+    }
+    SCAN_EMIT(s, start, (size_t)(end - start));
+    s->p = end;
+    return LEPT_PARSE_OK;
+}
+
+static int lept_scan_literal(lept_scanner* s, const char* lit, size_t len){
+    if ((size_t)(s->end - s->p) < len || memcmp(s->p, lit, len) != 0)
+        return LEPT_PARSE_INVALID_VALUE;
+    SCAN_EMIT(s, lit, len);
+    s->p += len;
+    return LEPT_PARSE_OK;
+}
+
+static int lept_scan_scalar(lept_scanner* s){
+    switch (SCAN_PEEK(s)){
+        case 'n': return lept_scan_literal(s, "null", 4);
+        case 't': return lept_scan_literal(s, "true", 4);
+        case 'f': return lept_scan_literal(s, "false", 5);
+        case '"': return lept_scan_string(s);
+        case '\0': return LEPT_PARSE_EXPECT_VALUE;
+        default: return lept_scan_number(s);
+    }
+}
+
+#ifndef LEPT_SCAN_INIT_DEPTH
+#define LEPT_SCAN_INIT_DEPTH 1024
+#endif
+
+// 数组和对象不递归（lept_parse能解析的嵌套深度这里也要能检查）：用一个位栈记下每一层是数组(0)还是对象(1)
+// 位栈先放在栈上，嵌套超过LEPT_SCAN_INIT_DEPTH层才分配内存；错误码和lept_parse_array / lept_parse_object一一对应
+static int lept_scan_value(lept_scanner* s){
+    uint64_t small[LEPT_SCAN_INIT_DEPTH / 64];
+    uint64_t* levels = small;
+    size_t depth = 0, cap = LEPT_SCAN_INIT_DEPTH;
+    int ret = LEPT_PARSE_OK, obj = 0;
+    char ch;
+    for (;;){
+        ch = SCAN_PEEK(s);
+        if (ch == '[' || ch == '{'){
+            obj = ch == '{';
+            SCAN_EMIT(s, s->p, 1);
+            s->p++;
+            lept_scan_whitespace(s);
+            if (SCAN_PEEK(s) == (obj ? '}' : ']')){
+                // 空容器和标量一样，直接算一个值
+                SCAN_EMIT(s, s->p, 1);
+                s->p++;
+            }
+            else {
+                if (depth == cap){
+                    cap *= 2;
+                    if (levels == small){
+                        levels = (uint64_t*)malloc(cap / 64 * sizeof(uint64_t));
+                        memcpy(levels, small, sizeof(small));
+                    }
+                    else
+                        levels = (uint64_t*)realloc(levels, cap / 64 * sizeof(uint64_t));
+                }
+                if (obj)
+                    levels[depth / 64] |= (uint64_t)1 << (depth % 64);
+                else
+                    levels[depth / 64] &= ~((uint64_t)1 << (depth % 64));
+                depth++;
+                if (!obj)
+                    continue;
+                goto key;
+            }
+        }
+        else if ((ret = lept_scan_scalar(s)) != LEPT_PARSE_OK)
+            goto out;
+        // 一个值结束了：关掉所有已经完整的容器，直到遇到逗号
+        for (;;){
+            if (depth == 0)
+                goto out;
+            obj = (int)(levels[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1;
+            lept_scan_whitespace(s);
+            ch = SCAN_PEEK(s);
+            if (ch == (obj ? '}' : ']')){
+                SCAN_EMIT(s, s->p, 1);
+                s->p++;
+                depth--;
+                continue;
+            }
+            if (ch != ','){
+                ret = obj ? LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET : LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                goto out;
+            }
+            SCAN_EMIT(s, ",", 1);
+            s->p++;
+            lept_scan_whitespace(s);
+            break;
+        }
+        if (!obj)
+            continue;
+    key:
+        if (SCAN_PEEK(s) != '"'){
+            ret = LEPT_PARSE_MISS_KEY;
+            goto out;
+        }
+        if ((ret = lept_scan_string(s)) != LEPT_PARSE_OK)
+            goto out;
+        lept_scan_whitespace(s);
+        if (SCAN_PEEK(s) != ':'){
+            ret = LEPT_PARSE_MISS_COLON;
+            goto out;
+        }
+        SCAN_EMIT(s, ":", 1);
+        s->p++;
+        lept_scan_whitespace(s);
+    }
+out:
+    if (levels != small)
+        free(levels);
+    return ret;
+}
+
+static int lept_scan(lept_scanner* s){
+    int ret;
+    lept_scan_whitespace(s);
+    if ((ret = lept_scan_value(s)) == LEPT_PARSE_OK){
+        lept_scan_whitespace(s);
+        if (s->p != s->end)
+            ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+    }
+    return ret;
+}
+
+int lept_validate(const char* json, size_t len){
+    lept_scanner s;
+    assert(json != NULL || len == 0);
+    s.p = json;
+    s.end = json + len;
+    s.out = NULL;
+    return lept_scan(&s);
+}
+
+int lept_minify(const char* json, size_t len, char* out, size_t* outLen){
+    lept_scanner s;
+    int ret;
+    assert((json != NULL || len == 0) && out != NULL);
+    s.p = json;
+    s.end = json + len;
+    s.out = out;
+    ret = lept_scan(&s);
+    *s.out = '\0';
+    if (outLen)
+        *outLen = ret == LEPT_PARSE_OK ? (size_t)(s.out - out) : 0;
+    return ret;
+}
+
+// 只读共享文档：节点一经创建就不再修改，子树靠引用计数在多棵树之间共享
+// 节点后面紧跟着数据：字符串是len个字节加'\0'，数组是size个子节点指针，对象是size个lept_node_member
+typedef struct{
+    const lept_node* k;     // 键也是字符串节点，复制容器时只需要加引用
+    const lept_node* v;
+}lept_node_member;
+
+struct lept_node{
+    mutable std::atomic<size_t> rc;     // 只有引用计数会变，节点内容不变
+    lept_type type;
+    union {
+        size_t size;    // 字符串长度 / 元素个数 / 成员个数
+        double n;
+    };
+};
+
+#define NODE_STR(n) ((char*)((n) + 1))
+#define NODE_ELEMENTS(n) ((const lept_node**)((n) + 1))
+#define NODE_MEMBERS(n) ((lept_node_member*)((n) + 1))
+
+static lept_node* lept_node_new(lept_type type, size_t extra){
+    lept_node* n = new (malloc(sizeof(lept_node) + extra)) lept_node;
+    n->rc.store(1, std::memory_order_relaxed);
+    n->type = type;
+    n->size = 0;
+    return n;
+}
+
+static lept_node* lept_node_new_str(const char* s, size_t len){
+    lept_node* n = lept_node_new(MY_STRING, len + 1);
+    memcpy(NODE_STR(n), s, len);
+    NODE_STR(n)[len] = '\0';
+    n->size = len;
+    return n;
+}
+
+void lept_node_retain(const lept_node* n){
+    assert(n != NULL);
+    n->rc.fetch_add(1, std::memory_order_relaxed);
+}
+
+void lept_node_release(const lept_node* n){
+    size_t i;
+    if (n == NULL || n->rc.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+    if (n->type == MY_ARRAY)
+        for (i = 0; i < n->size; ++i)
+            lept_node_release(NODE_ELEMENTS(n)[i]);
+    else if (n->type == MY_OBJECT)
+        for (i = 0; i < n->size; ++i){
+            lept_node_release(NODE_MEMBERS(n)[i].k);
+            lept_node_release(NODE_MEMBERS(n)[i].v);
+        }
+    n->~lept_node();
+    free((void*)n);
+}
+
+static lept_node* lept_node_from_value(const lept_value* v){
+    lept_node* n;
+    size_t i;
+    switch (v->type){
+    case MY_NUMBER:
+        n = lept_node_new(MY_NUMBER, 0);
+        n->n = v->n;
+        return n;
+    case MY_STRING:
+        return lept_node_new_str(v->s, v->len);
+    case MY_ARRAY:
+        // 紧凑数组也展开成一个个节点，这样按下标取出来的都是lept_node
+        n = lept_node_new(MY_ARRAY, v->arrSize * sizeof(lept_node*));
+        n->size = v->arrSize;
+        for (i = 0; i < v->arrSize; ++i){
+            if (v->arrKind == LEPT_ARRAY_NUMBERS){
+                lept_node* e = lept_node_new(MY_NUMBER, 0);
+                e->n = v->ne[i];
+                NODE_ELEMENTS(n)[i] = e;
+            }
+            else
+                NODE_ELEMENTS(n)[i] = lept_node_from_value(&v->e[i]);
+        }
+        return n;
+    case MY_OBJECT:
+        n = lept_node_new(MY_OBJECT, v->objSize * sizeof(lept_node_member));
+        n->size = v->objSize;
+        for (i = 0; i < v->objSize; ++i){
+            NODE_MEMBERS(n)[i].k = lept_node_new_str(v->m[i].k, v->m[i].klen);
+            NODE_MEMBERS(n)[i].v = lept_node_from_value(&v->m[i].v);
+        }
+        return n;
+    default:
+        return lept_node_new(v->type, 0);
+    }
+}
+
+const lept_node* lept_freeze(lept_value* v){
+    const lept_node* n;
+    assert(v != NULL);
+    n = lept_node_from_value(v);
+    lept_free(v);
+    v->type = MY_NULL;
+    return n;
+}
+
+lept_type lept_node_get_type(const lept_node* n){
+    assert(n != NULL);
+    return n->type;
+}
+
+int lept_node_get_bool(const lept_node* n){
+    assert(n != NULL && (n->type == MY_TRUE || n->type == MY_FALSE));
+    return n->type == MY_TRUE;
+}
+
+double lept_node_get_number(const lept_node* n){
+    assert(n != NULL && n->type == MY_NUMBER);
+    return n->n;
+}
+
+const char* lept_node_get_str(const lept_node* n){
+    assert(n != NULL && n->type == MY_STRING);
+    return NODE_STR(n);
+}
+
+size_t lept_node_get_str_len(const lept_node* n){
+    assert(n != NULL && n->type == MY_STRING);
+    return n->size;
+}
+
+size_t lept_node_get_array_size(const lept_node* n){
+    assert(n != NULL && n->type == MY_ARRAY);
+    return n->size;
+}
+
+const lept_node* lept_node_get_array_element(const lept_node* n, size_t index){
+    assert(n != NULL && n->type == MY_ARRAY && index < n->size);
+    return NODE_ELEMENTS(n)[index];
+}
+
+size_t lept_node_get_object_size(const lept_node* n){
+    assert(n != NULL && n->type == MY_OBJECT);
+    return n->size;
+}
+
+const char* lept_node_get_object_key(const lept_node* n, size_t index){
+    assert(n != NULL && n->type == MY_OBJECT && index < n->size);
+    return NODE_STR(NODE_MEMBERS(n)[index].k);
+}
+
+size_t lept_node_get_object_key_length(const lept_node* n, size_t index){
+    assert(n != NULL && n->type == MY_OBJECT && index < n->size);
+    return NODE_MEMBERS(n)[index].k->size;
+}
+
+const lept_node* lept_node_get_object_value(const lept_node* n, size_t index){
+    assert(n != NULL && n->type == MY_OBJECT && index < n->size);
+    return NODE_MEMBERS(n)[index].v;
+}
+
+// JSON Pointer（RFC 6901）：取出下一段，返回这一段的结尾；段里的~0、~1在比较时再解码
+static const char* lept_pointer_segment(const char* p){
+    assert(*p == '/');
+    for (++p; *p != '\0' && *p != '/'; ++p);
+    return p;
+}
+
+static int lept_pointer_match(const char* seg, const char* segEnd, const char* k, size_t klen){
+    const char* kend = k + klen;
+    for (; seg != segEnd; ++seg, ++k){
+        char ch = *seg;
+        if (ch == '~'){
+            if (++seg == segEnd || (*seg != '0' && *seg != '1')) return 0;
+            ch = *seg == '0' ? '~' : '/';
+        }
+        if (k == kend || *k != ch) return 0;
+    }
+    return k == kend;
+}
+
+// 数组下标：不能有前导0；"-"表示末尾之后的位置
+static int lept_pointer_index(const char* seg, const char* segEnd, size_t size, size_t* index){
+    size_t i = 0;
+    if (segEnd - seg == 1 && *seg == '-') {
+        *index = size;
+        return 1;
+    }
+    if (seg == segEnd || (*seg == '0' && segEnd - seg > 1)) return 0;
+    for (; seg != segEnd; ++seg){
+        if (*seg < '0' || *seg > '9' || i > (SIZE_MAX - 9) / 10) return 0;
+        i = i * 10 + (*seg - '0');
+    }
+    *index = i;
+    return 1;
+}
+
+static const lept_node* lept_node_find_member(const lept_node* n, const char* seg, const char* segEnd, size_t* index){
+    for (size_t i = 0; i < n->size; ++i){
+        const lept_node* k = NODE_MEMBERS(n)[i].k;
+        if (lept_pointer_match(seg, segEnd, NODE_STR(k), k->size)){
+            *index = i;
+            return NODE_MEMBERS(n)[i].v;
+        }
+    }
+    return NULL;
+}
+
+const lept_node* lept_node_get_pointer(const lept_node* n, const char* pointer){
+    const char* end;
+    size_t i;
+    assert(n != NULL && pointer != NULL);
+    for (; *pointer != '\0'; pointer = end){
+        if (*pointer != '/') return NULL;
+        end = lept_pointer_segment(pointer);
+        if (n->type == MY_OBJECT)
+            n = lept_node_find_member(n, pointer + 1, end, &i);
+        else if (n->type == MY_ARRAY)
+            n = lept_pointer_index(pointer + 1, end, n->size, &i) && i < n->size ? NODE_ELEMENTS(n)[i] : NULL;
+        else
+            n = NULL;
+        if (n == NULL) return NULL;
+    }
+    return n;
+}
+
+// 复制容器（只复制指针并加引用），跳过下标为skip的那一个，留出extra个空位在末尾
+static lept_node* lept_node_copy_array(const lept_node* n, size_t skip, size_t extra){
+    lept_node* c = lept_node_new(MY_ARRAY, (n->size + extra) * sizeof(lept_node*));
+    size_t i, j;
+    for (i = j = 0; i < n->size; ++i)
+        if (i != skip) {
+            lept_node_retain(NODE_ELEMENTS(c)[j++] = NODE_ELEMENTS(n)[i]);
+        }
+    c->size = j;
+    return c;
+}
+
+static lept_node* lept_node_copy_object(const lept_node* n, size_t skip, size_t extra){
+    lept_node* c = lept_node_new(MY_OBJECT, (n->size + extra) * sizeof(lept_node_member));
+    size_t i, j;
+    for (i = j = 0; i < n->size; ++i)
+        if (i != skip) {
+            NODE_MEMBERS(c)[j] = NODE_MEMBERS(n)[i];
+            lept_node_retain(NODE_MEMBERS(c)[j].k);
+            lept_node_retain(NODE_MEMBERS(c)[j].v);
+            j++;
+        }
+    c->size = j;
+    return c;
+}
+
+// 新的键节点：把段里的~0、~1解码
+static lept_node* lept_pointer_key(const char* seg, const char* segEnd){
+    lept_node* k = lept_node_new(MY_STRING, (size_t)(segEnd - seg) + 1);
+    char* s = NODE_STR(k);
+    for (; seg != segEnd; ++seg)
+        *s++ = *seg == '~' ? (*++seg == '0' ? '~' : '/') : *seg;
+    *s = '\0';
+    k->size = (size_t)(s - NODE_STR(k));
+    return k;
+}
+
+// 沿着路径复制：返回新的子树，路径上的容器都是新的，其他子树都和原来的共享；路径不对返回NULL
+static const lept_node* lept_node_set_at(const lept_node* n, const char* pointer, const lept_node* value){
+    const lept_node *child, *c2;
+    lept_node* c;
+    const char* seg = pointer + 1;
+    const char* end;
+    size_t i;
+    int last;
+    if (*pointer == '\0'){
+        if (value != NULL) lept_node_retain(value);
+        return value;
+    }
+    if (*pointer != '/')
+        return NULL;
+    end = lept_pointer_segment(pointer);
+    last = *end == '\0';
+    if (n->type == MY_OBJECT){
+        child = lept_node_find_member(n, seg, end, &i);
+        if (child == NULL){
+            // 只有最后一段可以加新成员
+            if (!last || value == NULL)
+                return NULL;
+            // '~'后面只能是0或1
+            for (const char* q = seg; q != end; ++q)
+                if (*q == '~' && (q + 1 == end || (q[1] != '0' && q[1] != '1'))) return NULL;
+            c = lept_node_copy_object(n, (size_t)-1, 1);
+            NODE_MEMBERS(c)[c->size].k = lept_pointer_key(seg, end);
+            lept_node_retain(NODE_MEMBERS(c)[c->size].v = value);
+            c->size++;
+            return c;
+        }
+        if (last && value == NULL)
+            return lept_node_copy_object(n, i, 0);
+        if ((c2 = lept_node_set_at(child, end, value)) == NULL)
+            return NULL;
+        c = lept_node_copy_object(n, (size_t)-1, 0);
+        lept_node_release(NODE_MEMBERS(c)[i].v);
+        NODE_MEMBERS(c)[i].v = c2;
+        return c;
+    }
+    if (n->type == MY_ARRAY){
+        if (!lept_pointer_index(seg, end, n->size, &i) || i > n->size)
+            return NULL;
+        if (i == n->size){
+            // 末尾之后：只能在最后一段追加
+            if (!last || value == NULL)
+                return NULL;
+            c = lept_node_copy_array(n, (size_t)-1, 1);
+            lept_node_retain(NODE_ELEMENTS(c)[c->size++] = value);
+            return c;
+        }
+        if (last && value == NULL)
+            return lept_node_copy_array(n, i, 0);
+        if ((c2 = lept_node_set_at(NODE_ELEMENTS(n)[i], end, value)) == NULL)
+            return NULL;
+        c = lept_node_copy_array(n, (size_t)-1, 0);
+        lept_node_release(NODE_ELEMENTS(c)[i]);
+        NODE_ELEMENTS(c)[i] = c2;
+        return c;
+    }
+    return NULL;
+}
+
+const lept_node* lept_node_set(const lept_node* root, const char* pointer, const lept_node* value){
+    assert(root != NULL && pointer != NULL);
+    return lept_node_set_at(root, pointer, value);
+}
+
+// 对外的接口:先得到类型
+lept_type lept_get_type(const lept_value* v){
+    assert(v != NULL);
+    return v->type;
+}
+
+// 先按照b=1时v为true、b=0时v为false算
+void lept_set_bool(lept_value* v, int b){
+    lept_free(v);
+    v->type = b==1 ? MY_TRUE : MY_FALSE;
+}
+
+int lept_get_bool(const lept_value* v){
+    assert(v->type == MY_TRUE || v->type == MY_FALSE);
+    assert(v != NULL);
+    return v->type == MY_TRUE ? 1 : 0;
+}
+
+// 写入数字
+void lept_set_number(lept_value* v, double n){
+    lept_free(v);
+    // 这里要不要加一个lept_parse_num？不然n不是正常要传进来的东西呢？-< 不需要，因为是在内部的解析器里调用这几个接口的
+    v->n = n;
+    v->type = MY_NUMBER;
+}
+
+// 得到数字
+double lept_get_number(const lept_value* v) {
+    assert(v != NULL && v->type == MY_NUMBER);
+    return v->n;
+}
+
+// TODO 这里要先cp一份str，既然是动态分配，cpp可以智能指针什么的把？
+void lept_set_str(lept_value* v, const char* s, size_t len){
+    assert(v != NULL && (s != NULL || len == 0));
+    lept_free(v);
+    v->s = (char*)malloc(len + 1);
+    memcpy(v->s, s, len);
+    v->s[len] = '\0';
+    v->len = len;
+    v->type = MY_STRING;
+}
+
+const char* lept_get_str(const lept_value* v) {
+    assert(v != NULL && v->type == MY_STRING);
+    return v->s;
+}
+
+size_t lept_get_str_len(const lept_value* v){
+    assert(v != NULL && v->type == MY_STRING);
+    return v->len;
+}
+
+size_t lept_get_array_size(const lept_value* v) {
+    assert(v != NULL && v->type == MY_ARRAY);
+    return v->arrSize;
+}
+
+// 紧凑数组展开成普通数组（哈希不变，缓存搬过去）
+void lept_unpack_array(lept_value* v){
+    double* ne = v->ne;
+    lept_value* e;
+    assert(v != NULL && v->type == MY_ARRAY);
+    if (v->arrKind != LEPT_ARRAY_NUMBERS)
+        return;
+    e = (lept_value*)lept_elements_alloc(v->arrSize * sizeof(lept_value));
+    for (size_t i = 0; i < v->arrSize; ++i){
+        e[i].type = MY_NUMBER;
+        e[i].n = ne[i];
+    }
+    lept_hash_cache_store(e, lept_hash_cache_load(ne));
+    lept_elements_free(ne);
+    v->e = e;
+    v->arrKind = LEPT_ARRAY_VALUES;
+}
+
+lept_value* lept_get_array_element(const lept_value* v, size_t index) {
+    assert(v != NULL && v->type == MY_ARRAY);
+    assert(index < v->arrSize);
+    // 紧凑数组里没有lept_value可以返回
+    if (v->arrKind != LEPT_ARRAY_VALUES)
+        return NULL;
+    return &v->e[index];
+}
+
+int lept_get_number_array(const lept_value* v, const double** ptr, size_t* len){
+    assert(v != NULL && v->type == MY_ARRAY && ptr != NULL && len != NULL);
+    if (v->arrKind != LEPT_ARRAY_NUMBERS)
+        return 0;
+    *ptr = v->ne;
+    *len = v->arrSize;
+    return 1;
+}
+
+double lept_get_array_number(const lept_value* v, size_t index){
+    assert(v != NULL && v->type == MY_ARRAY);
+    assert(index < v->arrSize);
+    if (v->arrKind == LEPT_ARRAY_NUMBERS)
+        return v->ne[index];
+    return lept_get_number(&v->e[index]);
+}
+
+size_t lept_get_object_size(const lept_value* v){
+    assert(v != NULL && v->type == MY_OBJECT);
+    return v->objSize;
+}
+
+const char* lept_get_object_key(const lept_value* v, size_t index){
+    assert(v != NULL && index>=0 && v->type == MY_OBJECT);
+    return v->m[index].k;
+}
+
+size_t lept_get_object_key_length(const lept_value* v, size_t index){
+    assert(v != NULL && v->type == MY_OBJECT && index>=0);
+    return v->m[index].klen;
+}
+lept_value* lept_get_object_value(const lept_value* v, size_t index){
+    assert(v != NULL && index < v->objSize && v->type == MY_OBJECT);
+    return &v->m[index].v;
+}
+
+static uint64_t lept_hash_member(const lept_member* m){
+    return lept_hash_mix(lept_hash_bytes(MY_STRING, m->k, m->klen) + lept_hash(&m->v) * LEPT_HASH_K);
+}
+
+uint64_t lept_hash(const lept_value* v){
+    uint64_t h;
+    size_t i;
+    assert(v != NULL);
+    switch (v->type){
+    case MY_NUMBER:
+        return lept_hash_number(v->n);
+    case MY_STRING:
+        return lept_hash_bytes(MY_STRING * LEPT_HASH_K, v->s, v->len);
+    case MY_ARRAY:
+        if (v->arrSize != 0 && (h = lept_hash_cache_load(v->e)) != 0)
+            return h;
+        h = MY_ARRAY * LEPT_HASH_K;
+        // 紧凑数组和展开后的数组哈希要一样
+        for (i = 0; i < v->arrSize; ++i)
+            h = lept_hash_mix(h + (v->arrKind == LEPT_ARRAY_NUMBERS ? lept_hash_number(v->ne[i]) : lept_hash(&v->e[i])));
+        h = lept_hash_mix(h ^ v->arrSize);
+        h += h == 0;    // 0留给“没算过”
+        if (v->arrSize != 0)
+            lept_hash_cache_store(v->e, h);
+        return h;
+    case MY_OBJECT:
+        if (v->objSize != 0 && (h = lept_hash_cache_load(v->m)) != 0)
+            return h;
+        // 成员顺序无关：各成员的哈希直接相加
+        h = 0;
+        for (i = 0; i < v->objSize; ++i)
+            h += lept_hash_member(&v->m[i]);
+        h = lept_hash_mix(h ^ (MY_OBJECT * LEPT_HASH_K) ^ v->objSize);
+        h += h == 0;
+        if (v->objSize != 0)
+            lept_hash_cache_store(v->m, h);
+        return h;
+    default:
+        return lept_hash_mix(v->type * LEPT_HASH_K);
+    }
+}
+
+// 成员数不超过这个值时直接两两查找，否则先排序
+#ifndef LEPT_EQUAL_SORT_THRESHOLD
+#define LEPT_EQUAL_SORT_THRESHOLD 16
+#endif
+
+typedef struct{
+    const lept_member* m;
+    uint64_t h;     // 值的哈希，排序时当第二关键字
+}lept_member_ref;
+
+static int lept_member_ref_cmp(const void* a, const void* b){
+    const lept_member_ref* x = (const lept_member_ref*)a;
+    const lept_member_ref* y = (const lept_member_ref*)b;
+    int r;
+    if (x->m->klen != y->m->klen)
+        return x->m->klen < y->m->klen ? -1 : 1;
+    if ((r = memcmp(x->m->k, y->m->k, x->m->klen)) != 0)
+        return r;
+    return x->h == y->h ? 0 : (x->h < y->h ? -1 : 1);
+}
+
+// 在b[begin, end)里给a找一个键和值都相等、还没用过的成员，找到就换到begin的位置（即标记为用过）
+static int lept_match_member(const lept_member* a, lept_member_ref* b, size_t begin, size_t end){
+    lept_member_ref t;
+    size_t i;
+    for (i = begin; i < end; ++i){
+        if (b[i].m->klen == a->klen && memcmp(b[i].m->k, a->k, a->klen) == 0 && lept_is_equal(&b[i].m->v, &a->v)){
+            t = b[i]; b[i] = b[begin]; b[begin] = t;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int lept_is_equal_object(const lept_value* lhs, const lept_value* rhs){
+    lept_member_ref small_b[LEPT_EQUAL_SORT_THRESHOLD];
+    lept_member_ref *a, *b;
+    size_t n = lhs->objSize, i, j, k;
+    int ret = 1;
+    if (n <= LEPT_EQUAL_SORT_THRESHOLD){
+        // 成员少：逐个在rhs里找，用过的换到前面去，这样重复的键也能正确配对
+        for (i = 0; i < n; ++i)
+            small_b[i].m = &rhs->m[i];
+        for (i = 0; i < n && ret; ++i)
+            ret = lept_match_member(&lhs->m[i], small_b, i, n);
+        return ret;
+    }
+    // 成员多：两边都按(键, 值的哈希)排序，之后只需要在键和哈希都相同的一小段里配对
+    a = (lept_member_ref*)malloc(2 * n * sizeof(lept_member_ref));
+    b = a + n;
+    for (i = 0; i < n; ++i){
+        a[i].m = &lhs->m[i]; a[i].h = lept_hash(&lhs->m[i].v);
+        b[i].m = &rhs->m[i]; b[i].h = lept_hash(&rhs->m[i].v);
+    }
+    qsort(a, n, sizeof(lept_member_ref), lept_member_ref_cmp);
+    qsort(b, n, sizeof(lept_member_ref), lept_member_ref_cmp);
+    for (i = 0; i < n && ret; i = j){
+        for (j = i + 1; j < n && lept_member_ref_cmp(&a[i], &a[j]) == 0; ++j);
+        // 相等的话b里对应的一段必须一模一样长
+        if (lept_member_ref_cmp(&a[i], &b[i]) != 0 || lept_member_ref_cmp(&a[j - 1], &b[j - 1]) != 0
+            || (j < n && lept_member_ref_cmp(&a[j - 1], &b[j]) == 0)){
+            ret = 0;
+            break;
+        }
+        for (k = i; k < j && ret; ++k)
+            ret = lept_match_member(a[k].m, b, k, j);
+    }
+    free(a);
+    return ret;
+}
+
+int lept_is_equal(const lept_value* lhs, const lept_value* rhs){
+    size_t i;
+    uint64_t lh, rh;
+    assert(lhs != NULL && rhs != NULL);
+    if (lhs == rhs)
+        return 1;
+    if (lhs->type != rhs->type)
+        return 0;
+    switch (lhs->type){
+    case MY_NUMBER:
+        return lhs->n == rhs->n;
+    case MY_STRING:
+        return lhs->len == rhs->len && memcmp(lhs->s, rhs->s, lhs->len) == 0;
+    case MY_ARRAY:
+        if (lhs->arrSize != rhs->arrSize)
+            return 0;
+        // 两边都算过哈希的话先比哈希
+        if (lhs->arrSize != 0 && (lh = lept_hash_cache_load(lhs->e)) != 0 && (rh = lept_hash_cache_load(rhs->e)) != 0 && lh != rh)
+            return 0;
+        if (lhs->arrKind == LEPT_ARRAY_NUMBERS && rhs->arrKind == LEPT_ARRAY_NUMBERS){
+            for (i = 0; i < lhs->arrSize; ++i)
+                if (lhs->ne[i] != rhs->ne[i])
+                    return 0;
+            return 1;
+        }
+        if (lhs->arrKind == LEPT_ARRAY_NUMBERS || rhs->arrKind == LEPT_ARRAY_NUMBERS){
+            // 一边紧凑一边不是：不紧凑的那边必须全是数字
+            const lept_value* packed = lhs->arrKind == LEPT_ARRAY_NUMBERS ? lhs : rhs;
+            const lept_value* values = packed == lhs ? rhs : lhs;
+            for (i = 0; i < lhs->arrSize; ++i)
+                if (values->e[i].type != MY_NUMBER || values->e[i].n != packed->ne[i])
+                    return 0;
+            return 1;
+        }
+        for (i = 0; i < lhs->arrSize; ++i)
+            if (!lept_is_equal(&lhs->e[i], &rhs->e[i]))
+                return 0;
+        return 1;
+    case MY_OBJECT:
+        if (lhs->objSize != rhs->objSize)
+            return 0;
+        if (lhs->objSize != 0 && (lh = lept_hash_cache_load(lhs->m)) != 0 && (rh = lept_hash_cache_load(rhs->m)) != 0 && lh != rh)
+            return 0;
+        return lept_is_equal_object(lhs, rhs);
+    default:
+        return 1;
+    }
+}
+
+// 流式输出
+#define LEPT_LEVEL_OBJECT   1   // 这一层是对象
+#define LEPT_LEVEL_NONEMPTY 2   // 这一层已经写过元素了，下一个前面要加','
+
+void lept_writer_init(lept_writer* w, lept_write_fn fn, void* ud){
+    assert(w != NULL && fn != NULL);
+    w->top = 0;
+    w->fn = fn;
+    w->ud = ud;
+    w->depth = 0;
+    w->afterKey = 0;
+    w->hasRoot = 0;
+    w->error = LEPT_WRITE_OK;
+}
+
+static int lept_write_fd(void* ud, const char* data, size_t len){
+    int fd = (int)(intptr_t)ud;
+    ssize_t n;
+    while (len > 0){
+        if ((n = write(fd, data, len)) < 0){
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+void lept_writer_init_fd(lept_writer* w, int fd){
+    lept_writer_init(w, lept_write_fd, (void*)(intptr_t)fd);    // fd直接塞进ud里，不用另外分配
+}
+
+static void lept_writer_flush(lept_writer* w){
+    if (w->top > 0 && w->error == LEPT_WRITE_OK && w->fn(w->ud, w->buf, w->top) != 0)
+        w->error = LEPT_WRITE_SINK_ERROR;
+    w->top = 0;
+}
+
+static void lept_writer_put(lept_writer* w, const char* data, size_t len){
+    if (w->top + len > LEPT_WRITER_BUF_SIZE){
+        lept_writer_flush(w);
+        // 比整个缓冲区还大的就不拷了，直接交给sink
+        if (len >= LEPT_WRITER_BUF_SIZE){
+            if (w->error == LEPT_WRITE_OK && w->fn(w->ud, data, len) != 0)
+                w->error = LEPT_WRITE_SINK_ERROR;
+            return;
+        }
+    }
+    memcpy(w->buf + w->top, data, len);
+    w->top += len;
+}
+
+#define PUTW(w, ch) do { if ((w)->top == LEPT_WRITER_BUF_SIZE) lept_writer_flush(w); (w)->buf[(w)->top++] = (ch); } while(0)
+
+int lept_writer_finish(lept_writer* w){
+    assert(w != NULL);
+    assert(w->error != LEPT_WRITE_OK || (w->depth == 0 && !w->afterKey));
+    lept_writer_flush(w);
+    return w->error;
+}
+
+// 写值之前：数组里要补','，对象里必须刚写过键，最外层只能有一个值
+static void lept_writer_before_value(lept_writer* w){
+    unsigned char* l;
+    if (w->depth == 0){
+        assert(!w->hasRoot && "more than one root");
+        w->hasRoot = 1;
+        return;
+    }
+    l = &w->level[w->depth - 1];
+    if (*l & LEPT_LEVEL_OBJECT){
+        assert(w->afterKey && "object value without key");
+        w->afterKey = 0;
+    }
+    else {
+        if (*l & LEPT_LEVEL_NONEMPTY)
+            PUTW(w, ',');
+        *l |= LEPT_LEVEL_NONEMPTY;
+    }
+}
+
+static void lept_writer_begin(lept_writer* w, unsigned char type, char ch){
+    if (w->error != LEPT_WRITE_OK)
+        return;
+    lept_writer_before_value(w);
+    if (w->depth == LEPT_WRITER_MAX_DEPTH){
+        w->error = LEPT_WRITE_TOO_DEEP;
+        return;
+    }
+    w->level[w->depth++] = type;
+    PUTW(w, ch);
+}
+
+static void lept_writer_end(lept_writer* w, unsigned char type, char ch){
+    if (w->error != LEPT_WRITE_OK)
+        return;
+    assert(w->depth > 0 && (w->level[w->depth - 1] & LEPT_LEVEL_OBJECT) == type && "unbalanced end");
+    assert(!w->afterKey && "object key without value");
+    w->depth--;
+    PUTW(w, ch);
+}
+
+void lept_write_begin_object(lept_writer* w){ lept_writer_begin(w, LEPT_LEVEL_OBJECT, '{'); }
+void lept_write_end_object(lept_writer* w){ lept_writer_end(w, LEPT_LEVEL_OBJECT, '}'); }
+void lept_write_begin_array(lept_writer* w){ lept_writer_begin(w, 0, '['); }
+void lept_write_end_array(lept_writer* w){ lept_writer_end(w, 0, ']'); }
+
+// 转义字符串：不需要转义的连续一段整体拷贝
+static void lept_writer_put_string(lept_writer* w, const char* s, size_t len){
+    static const char hex[] = "0123456789ABCDEF";
+    const char* run = s;
+    const char* end = s + len;
+    char esc[6] = { '\\', 'u', '0', '0', 0, 0 };
+    PUTW(w, '"');
+    for (; s < end; ++s){
+        unsigned char ch = (unsigned char)*s;
+        if (ch >= 0x20 && ch != '"' && ch != '\\')
+            continue;
+        lept_writer_put(w, run, (size_t)(s - run));
+        run = s + 1;
+        switch (ch){
+            case '"':  lept_writer_put(w, "\\\"", 2); break;
+            case '\\': lept_writer_put(w, "\\\\", 2); break;
+            case '\b': lept_writer_put(w, "\\b", 2); break;
+            case '\f': lept_writer_put(w, "\\f", 2); break;
+            case '\n': lept_writer_put(w, "\\n", 2); break;
+            case '\r': lept_writer_put(w, "\\r", 2); break;
+            case '\t': lept_writer_put(w, "\\t", 2); break;
+            default:
+                esc[4] = hex[ch >> 4];
+                esc[5] = hex[ch & 15];
+                lept_writer_put(w, esc, 6);
+        }
+    }
+    lept_writer_put(w, run, (size_t)(s - run));
+    PUTW(w, '"');
+}
+
+void lept_write_key(lept_writer* w, const char* k, size_t klen){
+    unsigned char* l;
+    assert(w != NULL && (k != NULL || klen == 0));
+    if (w->error != LEPT_WRITE_OK)
+        return;
+    assert(w->depth > 0 && (w->level[w->depth - 1] & LEPT_LEVEL_OBJECT) && "key outside object");
+    assert(!w->afterKey && "two keys in a row");
+    l = &w->level[w->depth - 1];
+    if (*l & LEPT_LEVEL_NONEMPTY)
+        PUTW(w, ',');
+    *l |= LEPT_LEVEL_NONEMPTY;
+    lept_writer_put_string(w, k, klen);
+    PUTW(w, ':');
+    w->afterKey = 1;
+}
+
+void lept_write_string(lept_writer* w, const char* s, size_t len){
+    assert(w != NULL && (s != NULL || len == 0));
+    if (w->error != LEPT_WRITE_OK)
+        return;
+    lept_writer_before_value(w);
+    lept_writer_put_string(w, s, len);
+}
+
+// 不是有限数时写null
+static void lept_writer_put_number(lept_writer* w, double n){
+    if (!isfinite(n)){
+        lept_writer_put(w, "null", 4);
+        return;
+    }
+    // %.17g最长24个字符左右，留够32个
+    if (w->top + 32 > LEPT_WRITER_BUF_SIZE)
+        lept_writer_flush(w);
+    // 先试短的：0.1用%.17g会写成0.10000000000000001；读回来还是同一个double才用
+    char* p = w->buf + w->top;
+    int len = snprintf(p, 32, "%.15g", n);
+    if (strtod(p, NULL) != n){
+        len = snprintf(p, 32, "%.16g", n);
+        if (strtod(p, NULL) != n)
+            len = snprintf(p, 32, "%.17g", n);
+    }
+    w->top += (size_t)len;
+}
+
+void lept_write_number(lept_writer* w, double n){
+    assert(w != NULL);
+    if (w->error != LEPT_WRITE_OK)
+        return;
+    lept_writer_before_value(w);
+    lept_writer_put_number(w, n);
+}
+
+void lept_write_bool(lept_writer* w, int b){
+    assert(w != NULL);
+    if (w->error != LEPT_WRITE_OK)
+        return;
+    lept_writer_before_value(w);
+    if (b) lept_writer_put(w, "true", 4);
+    else lept_writer_put(w, "false", 5);
+}
+
+void lept_write_null(lept_writer* w){
+    assert(w != NULL);
+    if (w->error != LEPT_WRITE_OK)
+        return;
+    lept_writer_before_value(w);
+    lept_writer_put(w, "null", 4);
+}
+
+void lept_write_value(lept_writer* w, const lept_value* v){
+    size_t i;
+    assert(w != NULL && v != NULL);
+    switch (v->type){
+    case MY_NULL:   lept_write_null(w); break;
+    case MY_FALSE:  lept_write_bool(w, 0); break;
+    case MY_TRUE:   lept_write_bool(w, 1); break;
+    case MY_NUMBER: lept_write_number(w, v->n); break;
+    case MY_STRING: lept_write_string(w, v->s, v->len); break;
+    case MY_ARRAY:
+        lept_write_begin_array(w);
+        for (i = 0; i < v->arrSize; ++i){
+            if (v->arrKind == LEPT_ARRAY_NUMBERS) lept_write_number(w, v->ne[i]);
+            else lept_write_value(w, &v->e[i]);
+        }
+        lept_write_end_array(w);
+        break;
+    case MY_OBJECT:
+        lept_write_begin_object(w);
+        for (i = 0; i < v->objSize; ++i){
+            lept_write_key(w, v->m[i].k, v->m[i].klen);
+            lept_write_value(w, &v->m[i].v);
+        }
+        lept_write_end_object(w);
+        break;
+    default: assert(0 && "invalid type");
+    }
+}
+
+// lept_stringify的sink：直接压进lept_context的栈
+static int lept_write_context(void* ud, const char* data, size_t len){
+    memcpy(lept_context_push((lept_context*)ud, len), data, len);
+    return 0;
+}
+
+// lept_stringify不走lept_write_begin_*，自己用一个栈来遍历：lept_parse没有深度限制，这里也不能有
+typedef struct { const lept_value* v; size_t i; } lept_stringify_frame;
+
+#ifndef LEPT_STRINGIFY_INIT_FRAMES
+#define LEPT_STRINGIFY_INIT_FRAMES 64
+#endif
+
+// 写标量，或者写出数组/对象的开括号并返回1（之后由调用者压栈）
+static int lept_stringify_open(lept_writer* w, const lept_value* v){
+    switch (v->type){
+    case MY_NULL:   lept_writer_put(w, "null", 4); return 0;
+    case MY_FALSE:  lept_writer_put(w, "false", 5); return 0;
+    case MY_TRUE:   lept_writer_put(w, "true", 4); return 0;
+    case MY_NUMBER: lept_writer_put_number(w, v->n); return 0;
+    case MY_STRING: lept_writer_put_string(w, v->s, v->len); return 0;
+    case MY_ARRAY:  PUTW(w, '['); return 1;
+    case MY_OBJECT: PUTW(w, '{'); return 1;
+    default: assert(0 && "invalid type"); return 0;
+    }
+}
+
+static void lept_stringify_value(lept_writer* w, const lept_value* v){
+    lept_stringify_frame small[LEPT_STRINGIFY_INIT_FRAMES];
+    lept_stringify_frame* frames = small;
+    lept_stringify_frame* f;
+    size_t top = 0, cap = LEPT_STRINGIFY_INIT_FRAMES;
+    if (!lept_stringify_open(w, v))
+        return;
+    frames[top].v = v; frames[top++].i = 0;
+    while (top > 0){
+        f = &frames[top - 1];
+        v = f->v;
+        if (f->i == (v->type == MY_ARRAY ? v->arrSize : v->objSize)){
+            PUTW(w, v->type == MY_ARRAY ? ']' : '}');
+            top--;
+            continue;
+        }
+        if (f->i > 0)
+            PUTW(w, ',');
+        if (v->type == MY_ARRAY && v->arrKind == LEPT_ARRAY_NUMBERS){
+            lept_writer_put_number(w, v->ne[f->i++]);
+            continue;
+        }
+        if (v->type == MY_OBJECT){
+            lept_writer_put_string(w, v->m[f->i].k, v->m[f->i].klen);
+            PUTW(w, ':');
+            v = &v->m[f->i++].v;
+        }
+        else
+            v = &v->e[f->i++];
+        if (!lept_stringify_open(w, v))
+            continue;
+        if (top == cap){
+            cap += cap >> 1;
+            if (frames == small){
+                frames = (lept_stringify_frame*)malloc(cap * sizeof(lept_stringify_frame));
+                memcpy(frames, small, top * sizeof(lept_stringify_frame));
+            }
+            else
+                frames = (lept_stringify_frame*)realloc(frames, cap * sizeof(lept_stringify_frame));
+        }
+        frames[top].v = v; frames[top++].i = 0;
+    }
+    if (frames != small)
+        free(frames);
+}
+
+char* lept_stringify(const lept_value* v, size_t* length){
+    lept_context c;
+    lept_writer w;
+    assert(v != NULL);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    c.stats = NULL;
+    c.depth = 0;
+    c.pack = 0;
+    lept_writer_init(&w, lept_write_context, &c);
+    lept_stringify_value(&w, v);
+    if (lept_writer_finish(&w) != LEPT_WRITE_OK){
+        // 写进内存的sink不会失败，这里只是以防万一
+        free(c.stack);
+        return NULL;
+    }
+    if (length)
+        *length = c.top;
+    PUTC(&c, '\0');
+    return c.stack;
 }
-lept_value* lept_get_object_value(const lept_value* v, size_t index){
-    assert(v != NULL && index>=0 && v->type == MY_OBJECT);
-    return &v->m->v;
-}
\ No newline at end of file
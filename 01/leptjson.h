@@ -2,6 +2,8 @@
 #define LEPTJSON_H__
 
 #include <stddef.h>
+#include <stdint.h>
+#include <bit>
 #define lept_init(v) do { (v)->type = MY_NULL; } while(0)
 
 // 定义json的数据类型
@@ -24,7 +26,15 @@ enum{
     LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,// 错过 ',' 或 '[]'
     LEPT_PARSE_MISS_KEY,                    // 没有key
     LEPT_PARSE_MISS_COLON,                  // 没有冒号（或者是缺少值的意思）
-    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET  // 错过 ',' 或 '{}'
+    LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, // 错过 ',' 或 '{}'
+    LEPT_PARSE_TYPE_MISMATCH,               // 值的类型和绑定的字段类型对不上
+    LEPT_PARSE_YIELD                        // 不是错误：lept_parse_step还没解析完
+};
+
+// 数组的存储方式：全是数字的数组解析成紧凑的double数组
+enum{
+    LEPT_ARRAY_VALUES = 0,  // e指向lept_value数组
+    LEPT_ARRAY_NUMBERS      // ne指向double数组
 };
 
 typedef struct lept_value lept_value;
@@ -33,12 +43,14 @@ typedef struct lept_member lept_member;
 struct lept_value{
     // union比直接随意扔在struct里更省内存->这里要看它的存储结构而不是数据大小
     union {
+        // 非空数组/对象的lept_hash缓存放在m/e/ne指向的那块内存前面，不占lept_value的地方
         struct { lept_member* m ; size_t objSize;}; // object : 包括每个元素的详情
-        struct { lept_value* e; size_t arrSize;}; // array : arrSize是元素个数！
+        struct { union { lept_value* e; double* ne; }; size_t arrSize;}; // array : arrSize是元素个数！
         struct { char* s; size_t len;}; //string
         double n;   // number
     };
     lept_type type;
+    unsigned char arrKind;  // 只对数组有意义：LEPT_ARRAY_VALUES / LEPT_ARRAY_NUMBERS（占的是对齐空出来的位置）
 };
 
 struct lept_member
@@ -50,6 +62,45 @@ struct lept_member
 
 // json的解析函数
 int lept_parse(lept_value* v, const char* json);
+// 和lept_parse一样，只是全是数字的数组存成紧凑的double数组（LEPT_ARRAY_NUMBERS），大约省2/3的内存；
+// 这样的数组要用lept_get_number_array/lept_get_array_number来读，lept_get_array_element只接受普通数组
+int lept_parse_packed(lept_value* v, const char* json);
+
+// 解析统计：用lept_parse_with_stats解析时填写；编译时定义LEPT_PARSE_NO_STATS可以把统计代码去掉
+typedef struct lept_parse_stats lept_parse_stats;
+struct lept_parse_stats
+{
+    size_t bytes;                   // 读到了第几个字节（出错时就是出错的位置）
+    size_t nodes[MY_OBJECT + 1];    // 每种类型各解析出了几个值，用lept_type做下标
+    size_t maxDepth;                // 数组/对象最深嵌套了几层
+    size_t stackPeak;               // lept_context栈用到的最高位置（字节）
+    size_t reallocs;                // lept_context_push里realloc的次数
+    size_t allocs;                  // 堆分配的总次数（包括上面的realloc）
+    // 可选的计时钩子：解析字符串、数字、数组、对象之前调用一次(leave=0)，之后再调用一次(leave=1)
+    // 对象的键也按MY_STRING调用钩子，但nodes只数值、不数键
+    void (*hook)(void* ud, lept_type type, int leave);
+    void* ud;
+};
+int lept_parse_with_stats(lept_value* v, const char* json, lept_parse_stats* stats);
+
+// 分段解析：不递归，状态都存在lept_parser里，每次lept_parse_step读大约max_bytes个字节就返回
+//   lept_parser p;
+//   lept_parser_init(&p, &v, json);
+//   while ((ret = lept_parse_step(&p, 64 * 1024)) == LEPT_PARSE_YIELD) { 先去处理别的事 }
+// 结果和lept_parse一样；json在解析完之前必须一直有效；中途放弃要调用lept_parser_free
+typedef struct lept_parser lept_parser;
+struct lept_parser
+{
+    lept_value* v;                  // 结果
+    const char* json;               // 下一次从这里接着读
+    char* stack; size_t size, top;  // lept_context的栈，额外存着每一层数组/对象的帧
+    size_t frame, depth;            // 最里层帧头在栈里的偏移，和一共几层
+    int state;
+    int packNumbers;                // lept_parser_init之后设为1：和lept_parse_packed一样存紧凑数组
+};
+void lept_parser_init(lept_parser* p, lept_value* v, const char* json);
+int lept_parse_step(lept_parser* p, size_t max_bytes);
+void lept_parser_free(lept_parser* p);
 
 // 获得json的类型（要有返回值）
 lept_type lept_get_type(const lept_value* v);
@@ -62,7 +113,15 @@ double lept_get_number(const lept_value* v);
 void lept_set_number(lept_value* v, double n);
 
 size_t lept_get_array_size(const lept_value* v);
+// 只读；紧凑数组返回NULL（要先lept_unpack_array，或者用lept_get_array_number），紧凑数组只有lept_parse_packed/packNumbers才会产生
 lept_value* lept_get_array_element(const lept_value* v, size_t index);
+// 紧凑数组返回1并给出double数组，否则返回0
+int lept_get_number_array(const lept_value* v, const double** ptr, size_t* len);
+// 按下标取数字，两种数组都可以
+double lept_get_array_number(const lept_value* v, size_t index);
+// 把紧凑数组展开成普通数组（已经是普通数组就什么都不做）。会重新分配元素：
+// 之前从lept_get_number_array拿到的指针随之失效，也不能和其它线程对同一棵树的读并发进行
+void lept_unpack_array(lept_value* v);
 
 #define lept_set_null(v) lept_free(v)
 const char* lept_get_str(const lept_value* v);
@@ -75,4 +134,195 @@ size_t lept_get_object_size(const lept_value* v);
 const char* lept_get_object_key(const lept_value* v, size_t index);
 size_t lept_get_object_key_length(const lept_value* v, size_t index);
 lept_value* lept_get_object_value(const lept_value* v, size_t index);
+
+// 深比较：对象成员不看顺序（重复的键按多重集合比较），数字0和-0相等
+int lept_is_equal(const lept_value* lhs, const lept_value* rhs);
+// 结构哈希：lept_is_equal相等的两个值哈希一定相同；结果与运行次数无关
+// 非空数组和对象的哈希会缓存在元素前面，所以算过哈希之后不要再原地修改里面的元素；
+// 缓存的读写是原子的，多个线程可以同时对同一棵树调用lept_hash/lept_is_equal
+uint64_t lept_hash(const lept_value* v);
+
+// lept_hash用到的几个小函数：leptjson.cpp和编译期的leptjson_static.h用的是同一份，两边的哈希才会一样
+// 每种类型一个种子，避免 [] / {} / "" 之类撞在一起
+#define LEPT_HASH_K 0x9E3779B97F4A7C15ULL
+
+inline constexpr uint64_t lept_hash_mix(uint64_t h){
+    // splitmix64的收尾
+    h ^= h >> 30; h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27; h *= 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+// 一次吃8个字节，总是按小端拼：大端平台上结果也一样（小端平台上编译器会合成一次读）
+inline constexpr uint64_t lept_hash_bytes(uint64_t seed, const char* s, size_t len){
+    uint64_t h = seed ^ (len * LEPT_HASH_K), w;
+    size_t i;
+    for (; len >= 8; s += 8, len -= 8){
+        for (w = 0, i = 0; i < 8; ++i) w |= (uint64_t)(unsigned char)s[i] << (8 * i);
+        h = (h ^ lept_hash_mix(w)) * LEPT_HASH_K;
+    }
+    for (w = 0, i = 0; i < len; ++i) w |= (uint64_t)(unsigned char)s[i] << (8 * i);
+    return lept_hash_mix(h ^ w);
+}
+
+inline constexpr uint64_t lept_hash_number(double n){
+    n = n == 0.0 ? 0.0 : n;     // -0和0相等，哈希也要一样
+    return lept_hash_mix(std::bit_cast<uint64_t>(n) ^ MY_NUMBER);
+}
+
+// 不建树的检查和压缩（去掉所有空白），返回值和lept_parse一样；没有深度限制，嵌套特别深时才分配一点内存
+// json不需要以'\0'结尾；out至少要有len + 1个字节，结果以'\0'结尾；outLen可以为NULL
+int lept_validate(const char* json, size_t len);
+int lept_minify(const char* json, size_t len, char* out, size_t* outLen);
+
+// 只读共享文档：lept_freeze把一棵lept_value树变成不可修改的lept_node树，之后可以在多个线程里同时读、不用加锁
+// 子树用原子引用计数共享；修改（lept_node_set）不会动原来的树，而是返回一个新的根，
+// 只有路径上的容器是新的，其余子树和原来的树共享
+// 返回lept_node*的创建类函数（lept_freeze / lept_node_set）给的是一个新引用，用完要lept_node_release；
+// get类函数返回的是借用，要长期保存就先lept_node_retain
+// 把新的根发布给其他线程（比如替换一个全局指针）需要调用方自己同步
+typedef struct lept_node lept_node;
+const lept_node* lept_freeze(lept_value* v);    // v的内容会被释放，之后v为MY_NULL
+void lept_node_retain(const lept_node* n);
+void lept_node_release(const lept_node* n);     // n可以为NULL
+
+lept_type lept_node_get_type(const lept_node* n);
+int lept_node_get_bool(const lept_node* n);
+double lept_node_get_number(const lept_node* n);
+const char* lept_node_get_str(const lept_node* n);
+size_t lept_node_get_str_len(const lept_node* n);
+size_t lept_node_get_array_size(const lept_node* n);
+const lept_node* lept_node_get_array_element(const lept_node* n, size_t index);
+size_t lept_node_get_object_size(const lept_node* n);
+const char* lept_node_get_object_key(const lept_node* n, size_t index);
+size_t lept_node_get_object_key_length(const lept_node* n, size_t index);
+const lept_node* lept_node_get_object_value(const lept_node* n, size_t index);
+
+// 路径用JSON Pointer（RFC 6901），比如"/a/0/b"，""是根本身；找不到返回NULL
+const lept_node* lept_node_get_pointer(const lept_node* n, const char* pointer);
+// 把pointer处的值换成value（value会被加引用）：对象里没有这个键时追加，数组用"-"或者size追加；
+// value为NULL时删除这个成员/元素。路径不对返回NULL
+const lept_node* lept_node_set(const lept_node* root, const char* pointer, const lept_node* value);
+
+// 流式输出：不用先建lept_value树，边写边格式化进缓冲区，缓冲区满了就交给sink
+#ifndef LEPT_WRITER_BUF_SIZE
+#define LEPT_WRITER_BUF_SIZE 4096
+#endif
+#ifndef LEPT_WRITER_MAX_DEPTH
+#define LEPT_WRITER_MAX_DEPTH 256
+#endif
+
+enum{
+    LEPT_WRITE_OK = 0,
+    LEPT_WRITE_SINK_ERROR,      // sink返回了错误
+    LEPT_WRITE_TOO_DEEP         // 嵌套超过了LEPT_WRITER_MAX_DEPTH层
+};
+
+// sink：返回0表示成功，非0表示出错（之后的写入都会被忽略）
+typedef int (*lept_write_fn)(void* ud, const char* data, size_t len);
+
+typedef struct lept_writer lept_writer;
+struct lept_writer
+{
+    char buf[LEPT_WRITER_BUF_SIZE]; size_t top;
+    lept_write_fn fn; void* ud;
+    unsigned char level[LEPT_WRITER_MAX_DEPTH]; size_t depth; // 每一层是数组还是对象、是否已经有元素
+    int afterKey;   // 刚写完键，等值
+    int hasRoot;    // 根已经开始写了，第二个根在debug下会assert
+    int error;
+};
+
+void lept_writer_init(lept_writer* w, lept_write_fn fn, void* ud);
+void lept_writer_init_fd(lept_writer* w, int fd);
+// 把缓冲区剩下的交给sink，返回LEPT_WRITE_*
+int lept_writer_finish(lept_writer* w);
+
+// 嵌套关系（对象里先key再值、括号配对、只有一个根）在debug下用assert检查
+void lept_write_begin_object(lept_writer* w);
+void lept_write_end_object(lept_writer* w);
+void lept_write_begin_array(lept_writer* w);
+void lept_write_end_array(lept_writer* w);
+void lept_write_key(lept_writer* w, const char* k, size_t klen);
+void lept_write_string(lept_writer* w, const char* s, size_t len);
+void lept_write_number(lept_writer* w, double n);      // 不是有限数时写null
+void lept_write_bool(lept_writer* w, int b);
+void lept_write_null(lept_writer* w);
+void lept_write_value(lept_writer* w, const lept_value* v);   // 写一整棵lept_value
+
+// 生成json字符串（malloc出来的，要自己free）；length可以为NULL
+// 不经过lept_write_begin_*，所以没有LEPT_WRITER_MAX_DEPTH的限制，lept_parse能解析出来的都能写回去
+char* lept_stringify(const lept_value* v, size_t* length);
+
+// 结构体绑定：直接把json对象解析进结构体、不经过lept_value树
+// 字段表一般由 leptjson_bind.h 里的模板在编译期生成，不用手写
+typedef enum{
+    LEPT_FIELD_NUMBER,  // double
+    LEPT_FIELD_INT,     // int，值必须是整数
+    LEPT_FIELD_INT64,   // long long，值必须是整数；不带小数和指数的按整数精确读，带的只接受2^53以下
+    LEPT_FIELD_BOOL,    // bool
+    LEPT_FIELD_STRING,  // 通过set_str写入（比如std::string）
+    LEPT_FIELD_OBJECT   // 嵌套的结构体，字段表在sub里
+}lept_field_kind;
+
+// 键 -> 字段的完美哈希表：slots[lept_field_hash(k, klen, seed) & mask]是字段下标+1，0表示没有这个键
+// 由leptjson_bind.h在编译期挑一个没有冲突的seed生成，查一个键只要算一次哈希、比一次
+typedef struct lept_field_index lept_field_index;
+struct lept_field_index
+{
+    const unsigned short* slots;
+    uint32_t mask, seed;
+};
+
+// FNV-1a，seed混进初值；编译期和运行时用的是同一个函数
+inline constexpr uint32_t lept_field_hash(const char* k, size_t klen, uint32_t seed){
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (size_t i = 0; i < klen; ++i)
+        h = (h ^ (unsigned char)k[i]) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+typedef struct lept_field lept_field;
+struct lept_field
+{
+    const char* k; size_t klen;                 // 键
+    lept_field_kind kind;
+    size_t offset;                              // 字段在结构体里的偏移
+    const lept_field* sub; size_t subSize;      // kind为OBJECT时的字段表
+    void (*set_str)(void* dst, const char* s, size_t len);  // kind为STRING时负责写入
+    const lept_field_index* subIndex;           // kind为OBJECT时sub的哈希表，可以为NULL
+};
+
+// 不认识的键会被跳过（但仍然检查格式）；值为null的字段保持原样不动
+// index可以为NULL：那样就按顺序找键（先试上一次匹配的下一个字段）
+// 返回错误时结构体里可能已经有一部分字段被写入了
+int lept_parse_fields(void* obj, const lept_field* fields, size_t n, const lept_field_index* index, const char* json);
+
+// 按列提取：从记录数组（[{...},{...}]）或NDJSON（每行一个对象）里只取要的字段，
+// 直接填进按列连续存放的缓冲区（类似Arrow），不生成lept_value
+typedef enum{
+    LEPT_COLUMN_NUMBER,     // numbers
+    LEPT_COLUMN_BOOL,       // bools（位图）
+    LEPT_COLUMN_STRING      // 第i行是chars[offsets[i], offsets[i+1])，不以'\0'结尾；offsets总有rows + 1个，没有行时也有offsets[0] == 0
+}lept_column_type;
+
+typedef struct lept_column lept_column;
+struct lept_column
+{
+    // 输入
+    const char* name; size_t nameLen;
+    lept_column_type type;
+    // 输出：第i行在valid的第i位（(valid[i/8] >> (i%8)) & 1），字段缺失或为null时是0
+    unsigned char* valid;
+    double* numbers;
+    unsigned char* bools;
+    size_t* offsets;
+    char* chars;
+    size_t capacity, charsSize, charsCapacity;
+};
+
+// 输出字段会被直接覆盖（用过的列要先lept_free_columns）；出错时已经分配的会被释放、rows为0
+// 值的类型和列对不上时返回LEPT_PARSE_TYPE_MISMATCH；记录不是对象也一样
+int lept_extract_columns(const char* json, lept_column* cols, size_t n, size_t* rows);
+int lept_extract_columns_ndjson(const char* json, lept_column* cols, size_t n, size_t* rows);
+void lept_free_columns(lept_column* cols, size_t n);
 #endif
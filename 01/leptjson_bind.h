@@ -0,0 +1,113 @@
+#ifndef LEPTJSON_BIND_H__
+#define LEPTJSON_BIND_H__
+
+#include "leptjson.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+/* 结构体绑定：每个结构体特化一次lept_bind、把字段列出来，之后就能直接解析进去
+ *
+ *   struct point { double x, y; };
+ *   template <> struct lept_bind<point> {
+ *       static constexpr lept_field fields[] = { LEPT_FIELD(point, x), LEPT_FIELD(point, y) };
+ *   };
+ *   point p;
+ *   lept_parse_into(&p, "{\"x\":1,\"y\":2}");
+ */
+template <typename T> struct lept_bind;    // 没有特化 = 没有绑定
+
+// 键的分派也在编译期生成：每个绑定的结构体一张完美哈希表（lept_bind_index），最多这么多个槽
+#ifndef LEPT_BIND_MAX_SLOTS
+#define LEPT_BIND_MAX_SLOTS 4096
+#endif
+
+// 字段类型 -> lept_field_kind；不支持的类型在这里就编译不过
+template <typename F, typename = void> struct lept_field_traits;
+template <> struct lept_field_traits<double>    { static constexpr lept_field_kind kind = LEPT_FIELD_NUMBER; };
+template <> struct lept_field_traits<int>       { static constexpr lept_field_kind kind = LEPT_FIELD_INT; };
+template <> struct lept_field_traits<long long> { static constexpr lept_field_kind kind = LEPT_FIELD_INT64; };
+template <> struct lept_field_traits<bool>      { static constexpr lept_field_kind kind = LEPT_FIELD_BOOL; };
+template <> struct lept_field_traits<std::string>{ static constexpr lept_field_kind kind = LEPT_FIELD_STRING; };
+// 自己也有lept_bind的结构体就当嵌套对象
+template <typename F> struct lept_field_traits<F, std::void_t<decltype(lept_bind<F>::fields)>> {
+    static constexpr lept_field_kind kind = LEPT_FIELD_OBJECT;
+};
+
+// 编译期检查：同一个结构体里不能有两个相同的键
+constexpr bool lept_fields_unique(const lept_field* fields, size_t n){
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = i + 1; j < n; ++j){
+            if (fields[i].klen != fields[j].klen) continue;
+            size_t l = 0;
+            while (l < fields[i].klen && fields[i].k[l] == fields[j].k[l]) l++;
+            if (l == fields[i].klen) return false;
+        }
+    return true;
+}
+
+// 在size个槽里试seed：所有键都落在不同的槽里就返回1
+constexpr int lept_index_fits(const lept_field* fields, size_t n, size_t size, uint32_t seed){
+    bool used[LEPT_BIND_MAX_SLOTS] = {};
+    for (size_t i = 0; i < n; ++i){
+        uint32_t h = lept_field_hash(fields[i].k, fields[i].klen, seed) & (uint32_t)(size - 1);
+        if (used[h]) return 0;
+        used[h] = true;
+    }
+    return 1;
+}
+
+// 完美哈希的参数：从不少于2n个槽开始试seed，试不出来就把槽数翻倍
+struct lept_index_params { size_t size; uint32_t seed; };
+
+constexpr lept_index_params lept_find_index(const lept_field* fields, size_t n){
+    size_t size = 2;
+    while (size < 2 * n) size *= 2;
+    for (; size <= LEPT_BIND_MAX_SLOTS; size *= 2)
+        for (uint32_t seed = 1; seed <= 1024; ++seed)
+            if (lept_index_fits(fields, n, size, seed))
+                return { size, seed };
+    return { 0, 0 };
+}
+
+template <typename T>
+struct lept_bind_index {
+    static constexpr size_t n = sizeof(lept_bind<T>::fields) / sizeof(lept_field);
+    static_assert(lept_fields_unique(lept_bind<T>::fields, n), "duplicate key in lept_bind");
+    static constexpr lept_index_params params = lept_find_index(lept_bind<T>::fields, n);
+    static_assert(params.size != 0, "no collision-free key hash for lept_bind");
+
+    struct table { unsigned short s[params.size]; };
+    static constexpr table make(){
+        table t = {};
+        for (size_t i = 0; i < n; ++i)
+            t.s[lept_field_hash(lept_bind<T>::fields[i].k, lept_bind<T>::fields[i].klen, params.seed) & (params.size - 1)] = (unsigned short)(i + 1);
+        return t;
+    }
+    static constexpr table slots = make();
+    static constexpr lept_field_index index = { slots.s, (uint32_t)(params.size - 1), params.seed };
+};
+
+template <typename F>
+constexpr lept_field lept_make_field(const char* k, size_t klen, size_t offset){
+    lept_field f = { k, klen, lept_field_traits<F>::kind, offset, NULL, 0, NULL, NULL };
+    if constexpr (lept_field_traits<F>::kind == LEPT_FIELD_STRING)
+        f.set_str = [](void* dst, const char* s, size_t len){ static_cast<std::string*>(dst)->assign(s, len); };
+    if constexpr (lept_field_traits<F>::kind == LEPT_FIELD_OBJECT){
+        f.sub = lept_bind<F>::fields;
+        f.subSize = lept_bind_index<F>::n;
+        f.subIndex = &lept_bind_index<F>::index;
+    }
+    return f;
+}
+
+// 键名就是成员名
+#define LEPT_FIELD(T, m) lept_make_field<decltype(T::m)>(#m, sizeof(#m) - 1, offsetof(T, m))
+
+template <typename T>
+int lept_parse_into(T* obj, const char* json){
+    return lept_parse_fields(obj, lept_bind<T>::fields, lept_bind_index<T>::n, &lept_bind_index<T>::index, json);
+}
+
+#endif
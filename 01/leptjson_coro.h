@@ -0,0 +1,60 @@
+#ifndef LEPTJSON_CORO_H__
+#define LEPTJSON_CORO_H__
+
+#include "leptjson.h"
+#include <coroutine>
+
+/* lept_parse_step的协程包装（需要C++20）
+ *
+ *   lept_parse_task t = lept_parse_async(&v, json, 64 * 1024);
+ *   while (t.resume()) { 先去处理别的连接 }
+ *   int ret = t.result();
+ *
+ * 创建时什么都不做，每次resume解析大约max_bytes个字节；没解析完就销毁task会释放中间状态
+ */
+class lept_parse_task {
+public:
+    struct promise_type {
+        int ret = LEPT_PARSE_YIELD;
+        lept_parse_task get_return_object() { return lept_parse_task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_value(int r) { ret = r; }
+        void unhandled_exception() {}
+    };
+
+    lept_parse_task(lept_parse_task&& o) noexcept : h(o.h) { o.h = nullptr; }
+    lept_parse_task(const lept_parse_task&) = delete;
+    lept_parse_task& operator=(const lept_parse_task&) = delete;
+    ~lept_parse_task() { if (h) h.destroy(); }
+
+    // 再解析一段；返回true表示还没完
+    bool resume() {
+        if (!h.done()) h.resume();
+        return !h.done();
+    }
+    bool done() const { return h.done(); }
+    // 解析完之前是LEPT_PARSE_YIELD
+    int result() const { return h.promise().ret; }
+
+private:
+    explicit lept_parse_task(std::coroutine_handle<promise_type> h) : h(h) {}
+    std::coroutine_handle<promise_type> h;
+};
+
+// 协程帧被提前销毁时由它来收拾lept_parser
+struct lept_parser_guard {
+    lept_parser p;
+    ~lept_parser_guard() { lept_parser_free(&p); }
+};
+
+inline lept_parse_task lept_parse_async(lept_value* v, const char* json, size_t max_bytes){
+    lept_parser_guard g;
+    int ret;
+    lept_parser_init(&g.p, v, json);
+    while ((ret = lept_parse_step(&g.p, max_bytes)) == LEPT_PARSE_YIELD)
+        co_await std::suspend_always{};
+    co_return ret;
+}
+
+#endif
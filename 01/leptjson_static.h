@@ -0,0 +1,534 @@
+#ifndef LEPTJSON_STATIC_H__
+#define LEPTJSON_STATIC_H__
+
+#include "leptjson.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* 编译期解析：json字面量在编译的时候就变成一棵只读的lept_value树，启动时不用再lept_parse（需要C++20）
+ *
+ *   const lept_value* cfg = lept_static_json<"{\"port\":8080}">();
+ *   lept_get_number(lept_get_object_value(cfg, 0));
+ *
+ * 语法、错误码和lept_parse完全一样，不合法的字面量直接编译不过；数字按strtod的方式正确舍入
+ * 结果放在只读数据段里（里面有指针，所以是.data.rel.ro：重定位完就只读），所以：不能lept_free、不能lept_set_*；数组都存成普通数组（紧凑数组取元素时要原地展开）；
+ * 数组和对象的哈希在编译期就算好了（lept_hash不会再去写缓存）
+ */
+
+// 编译期的字符串参数：把字面量整个拷进模板参数里
+template <size_t N>
+struct lept_literal {
+    char s[N];
+    constexpr lept_literal(const char (&str)[N]) : s{} {
+        for (size_t i = 0; i < N; ++i) s[i] = str[i];
+    }
+};
+
+/* 编译期的strtod：十进制转成最接近的double（一样远取偶数），和glibc的strtod结果相同
+ * 有效数字不多（<=15位、10的幂不超过22）时直接一次乘除就是精确舍入的；
+ * 否则用大整数算 数字/10^k 的前53位和余数。超过768位的有效数字只记一个“后面不全是0”，这不会影响舍入
+ */
+#define LEPT_STATIC_MAX_DIGITS 768
+#define LEPT_STATIC_BIGINT_LIMBS 128    // 4096位：最大的情况是10^(769+330)再左移53位
+
+struct lept_static_bigint {
+    uint32_t d[LEPT_STATIC_BIGINT_LIMBS] = {};
+    size_t n = 0;   // 用到的limb数，最高的那个不是0
+
+    constexpr void mul_add(uint32_t m, uint32_t a){
+        uint64_t carry = a;
+        for (size_t i = 0; i < n; ++i){
+            carry += (uint64_t)d[i] * m;
+            d[i] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        if (carry) d[n++] = (uint32_t)carry;
+    }
+    constexpr void shl(size_t bits){
+        size_t w = bits / 32, b = bits % 32;
+        if (n == 0) return;
+        d[n + w] = 0;
+        for (size_t i = n; i-- > 0; ){
+            d[i + w + 1] |= b ? d[i] >> (32 - b) : 0;
+            d[i + w] = d[i] << b;
+        }
+        for (size_t i = 0; i < w; ++i) d[i] = 0;
+        n += w + 1;
+        while (n > 0 && d[n - 1] == 0) n--;
+    }
+    constexpr void sub(const lept_static_bigint& o){    // 要求*this >= o
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < n; ++i){
+            uint64_t t = (uint64_t)d[i] - (i < o.n ? o.d[i] : 0) - borrow;
+            d[i] = (uint32_t)t;
+            borrow = (t >> 32) & 1;
+        }
+        while (n > 0 && d[n - 1] == 0) n--;
+    }
+    constexpr int cmp(const lept_static_bigint& o) const {
+        if (n != o.n) return n < o.n ? -1 : 1;
+        for (size_t i = n; i-- > 0; )
+            if (d[i] != o.d[i]) return d[i] < o.d[i] ? -1 : 1;
+        return 0;
+    }
+    constexpr size_t bits() const {
+        return n == 0 ? 0 : n * 32 - std::countl_zero(d[n - 1]);
+    }
+};
+
+constexpr lept_static_bigint lept_static_pow10(size_t e){
+    lept_static_bigint b;
+    b.mul_add(1, 1);
+    for (; e >= 9; e -= 9) b.mul_add(1000000000u, 0);
+    for (; e > 0; --e) b.mul_add(10, 0);
+    return b;
+}
+
+// 数字文本[p, end)已经通过了check_number；返回0表示溢出（strtod会返回HUGE_VAL）
+constexpr int lept_static_strtod(const char* p, const char* end, double* out){
+    char digits[LEPT_STATIC_MAX_DIGITS + 1] = {};
+    size_t nd = 0;
+    long e10 = 0, exp = 0;
+    int neg = 0, expNeg = 0, truncated = 0, seenDot = 0;
+    if (*p == '-') { neg = 1; p++; }
+    // 有效数字：去掉前导0，值 = 0.digits * 10^e10
+    for (; p != end && *p != 'e' && *p != 'E'; ++p){
+        if (*p == '.') { seenDot = 1; continue; }
+        if (nd == 0 && *p == '0') { if (seenDot) e10--; continue; }
+        if (!seenDot) e10++;
+        if (nd < LEPT_STATIC_MAX_DIGITS) digits[nd++] = *p - '0';
+        else if (*p != '0') truncated = 1;
+    }
+    if (p != end){
+        p++;
+        if (*p == '+' || *p == '-') expNeg = *p++ == '-';
+        for (; p != end; ++p)
+            if (exp < 100000) exp = exp * 10 + (*p - '0');
+    }
+    e10 += expNeg ? -exp : exp;
+    while (nd > 0 && digits[nd - 1] == 0) nd--;
+    if (truncated) digits[nd++] = 1;    // 后面还有非0：补一位1，舍入方向不会变
+    if (nd == 0 || e10 < -330) { *out = neg ? -0.0 : 0.0; return 1; }
+    if (e10 > 310) return 0;
+
+    // 值 = digits * 10^k
+    long k = e10 - (long)nd;
+    if (nd <= 15 && k >= -22 && k <= 22){
+        double m = 0, p10 = 1;
+        for (size_t i = 0; i < nd; ++i) m = m * 10 + digits[i];
+        for (long i = 0; i < (k < 0 ? -k : k); ++i) p10 *= 10;
+        m = k < 0 ? m / p10 : m * p10;
+        *out = neg ? -m : m;
+        return 1;
+    }
+
+    lept_static_bigint num, den, a, b;
+    for (size_t i = 0; i < nd; ++i) num.mul_add(10, digits[i]);
+    if (k >= 0) {
+        for (; k >= 9; k -= 9) num.mul_add(1000000000u, 0);
+        for (; k > 0; --k) num.mul_add(10, 0);
+        den.mul_add(1, 1);
+    }
+    else
+        den = lept_static_pow10((size_t)-k);
+
+    // 找e2使 q = num / den / 2^e2 落在[2^52, 2^53)；值太小时e2最小只能是-1074（非规格化数）
+    long e2 = (long)num.bits() - (long)den.bits() - 53;
+    for (;;){
+        if (e2 < -1074) e2 = -1074;
+        a = num; b = den;
+        if (e2 < 0) a.shl((size_t)-e2); else b.shl((size_t)e2);
+        lept_static_bigint hi = b, lo = b;
+        hi.shl(53); lo.shl(52);
+        if (a.cmp(hi) >= 0) { e2++; continue; }
+        if (a.cmp(lo) < 0 && e2 > -1074) { e2--; continue; }
+        break;
+    }
+    uint64_t q = 0;
+    for (int i = 52; i >= 0; --i){
+        lept_static_bigint t = b;
+        t.shl((size_t)i);
+        if (a.cmp(t) >= 0) { a.sub(t); q |= 1ULL << i; }
+    }
+    a.shl(1);   // 余数的两倍和除数比：就近舍入，一样远取偶数
+    int c = a.cmp(b);
+    if (c > 0 || (c == 0 && (q & 1))) q++;
+    if (q == 1ULL << 53) { q >>= 1; e2++; }
+    if (e2 > 971) return 0;
+    uint64_t bits = q < (1ULL << 52) ? q : ((uint64_t)(e2 + 1075) << 52) | (q & ((1ULL << 52) - 1));
+    if (neg) bits |= 1ULL << 63;
+    *out = std::bit_cast<double>(bits);
+    return 1;
+}
+
+/* 非空数组/对象的元素前面要有一个缓存哈希的uint64_t（leptjson.cpp里的LEPT_HASH_HEADER），
+ * 所以存放的格子要么是一个值，要么只在最后8个字节放哈希：每个元素块前面多占一格
+ */
+union lept_static_value_cell {
+    lept_value v;
+    struct { char pad[sizeof(lept_value) - sizeof(uint64_t)]; uint64_t h; } cache;
+};
+union lept_static_member_cell {
+    lept_member m;
+    struct { char pad[sizeof(lept_member) - sizeof(uint64_t)]; uint64_t h; } cache;
+};
+static_assert(sizeof(lept_static_value_cell) == sizeof(lept_value) && sizeof(lept_static_member_cell) == sizeof(lept_member),
+    "hash slot must sit right before the next cell");
+
+/* 解析器本体：结构照搬lept_parse_value，同一份代码跑两遍
+ * 第一遍（values为NULL）只检查语法、数出要多少个lept_value/lept_member/字符；
+ * 第二遍把结果写进values/members/chars，指针则指向最终存放的位置fvalues/fmembers/fchars
+ * 数组的元素要连续存放，所以第二遍遇到数组/对象先用一个只计数的副本（shallow）数出有几个直接元素
+ */
+struct lept_static_parser {
+    const char* json;
+    lept_static_value_cell* values; lept_static_member_cell* members; char* chars;
+    const lept_static_value_cell* fvalues; const lept_static_member_cell* fmembers; const char* fchars;
+    size_t nv, nm, nc;
+    int shallow;
+
+    constexpr void whitespace(){
+        while (*json == ' ' || *json == '\t' || *json == '\n' || *json == '\r')
+            json++;
+    }
+
+    constexpr int ntf(lept_value* v, const char* flag, lept_type type){
+        json++;
+        for (size_t i = 1; flag[i]; ++i, ++json)
+            if (*json != flag[i])
+                return LEPT_PARSE_INVALID_VALUE;
+        if (v) v->type = type;
+        return LEPT_PARSE_OK;
+    }
+
+    // 返回数字的长度，不合法返回0（这里不和NULL比较指针：开了-fsanitize的GCC不认为那是常量表达式）
+    constexpr size_t check_number(const char* p){
+        const char* start = p;
+        if (*p == '-') p++;
+        if (*p == '0') p++;
+        else {
+            if (*p < '1' || *p > '9') return 0;
+            for (p++; *p >= '0' && *p <= '9'; p++);
+        }
+        if (*p == '.') {
+            p++;
+            if (*p < '0' || *p > '9') return 0;
+            for (p++; *p >= '0' && *p <= '9'; p++);
+        }
+        if (*p == 'e' || *p == 'E') {
+            p++;
+            if (*p == '+' || *p == '-') p++;
+            if (*p < '0' || *p > '9') return 0;
+            for (p++; *p >= '0' && *p <= '9'; p++);
+        }
+        return p - start;
+    }
+
+    constexpr int number(lept_value* v){
+        size_t len = check_number(json);
+        double n = 0;
+        if (len == 0) return LEPT_PARSE_INVALID_VALUE;
+        if (!shallow && !lept_static_strtod(json, json + len, &n)) return LEPT_PARSE_NUMBER_TOO_BIG;
+        json += len;
+        if (v) { v->type = MY_NUMBER; v->n = n; }
+        return LEPT_PARSE_OK;
+    }
+
+    // 正好读4位，p移到后面；不合法返回0
+    constexpr int hex4(const char*& p, unsigned* u){
+        *u = 0;
+        for (int i = 0; i < 4; ++i, ++p){
+            *u <<= 4;
+            if      (*p >= '0' && *p <= '9') *u |= *p - '0';
+            else if (*p >= 'A' && *p <= 'F') *u |= *p - ('A' - 10);
+            else if (*p >= 'a' && *p <= 'f') *u |= *p - ('a' - 10);
+            else return 0;
+        }
+        return 1;
+    }
+
+    constexpr void putc(size_t* len, unsigned ch){
+        if (chars) chars[nc + *len] = (char)ch;
+        ++*len;
+    }
+
+    // 字符串解码到chars[nc]开始的位置，并补一个'\0'
+    constexpr int str_raw(size_t* len){
+        const char* p = json + 1;
+        unsigned u, u2;
+        *len = 0;
+        for (;;){
+            char ch = *p++;
+            switch (ch) {
+            case '\\':
+                switch (*p++) {
+                case '\"': putc(len, '\"'); break;
+                case '\\': putc(len, '\\'); break;
+                case '/':  putc(len, '/');  break;
+                case 'b':  putc(len, '\b'); break;
+                case 'f':  putc(len, '\f'); break;
+                case 'n':  putc(len, '\n'); break;
+                case 'r':  putc(len, '\r'); break;
+                case 't':  putc(len, '\t'); break;
+                case 'u':
+                    if (!hex4(p, &u))
+                        return LEPT_PARSE_INVALID_UNICODE_HEX;
+                    if (u >= 0xD800 && u <= 0xDBFF) {
+                        if (*p++ != '\\')
+                            return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                        if (*p++ != 'u')
+                            return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                        if (!hex4(p, &u2))
+                            return LEPT_PARSE_INVALID_UNICODE_HEX;
+                        if (u2 < 0xDC00 || u2 > 0xDFFF)
+                            return LEPT_PARSE_INVALID_UNICODE_SURROGATE;
+                        u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+                    }
+                    if (u <= 0x7F)
+                        putc(len, u);
+                    else if (u <= 0x7FF) {
+                        putc(len, 0xC0 | ((u >> 6) & 0xFF));
+                        putc(len, 0x80 | ( u       & 0x3F));
+                    }
+                    else if (u <= 0xFFFF) {
+                        putc(len, 0xE0 | ((u >> 12) & 0xFF));
+                        putc(len, 0x80 | ((u >>  6) & 0x3F));
+                        putc(len, 0x80 | ( u        & 0x3F));
+                    }
+                    else {
+                        putc(len, 0xF0 | ((u >> 18) & 0xFF));
+                        putc(len, 0x80 | ((u >> 12) & 0x3F));
+                        putc(len, 0x80 | ((u >>  6) & 0x3F));
+                        putc(len, 0x80 | ( u        & 0x3F));
+                    }
+                    break;
+                default:
+                    return LEPT_PARSE_INVALID_STRING_ESCAPE;
+                }
+                break;
+            case '\"':
+                if (chars) chars[nc + *len] = '\0';
+                json = p;
+                return LEPT_PARSE_OK;
+            case '\0':
+                return LEPT_PARSE_MISS_QUOTATION_MARK;
+            default:
+                if ((unsigned char)ch < 0x20)
+                    return LEPT_PARSE_INVALID_STRING_CHAR;
+                putc(len, (unsigned char)ch);
+            }
+        }
+    }
+
+    constexpr int str(lept_value* v, uint64_t* h){
+        size_t len;
+        int ret = str_raw(&len);
+        if (ret != LEPT_PARSE_OK) return ret;
+        if (v) {
+            v->type = MY_STRING;
+            v->s = const_cast<char*>(fchars + nc);
+            v->len = len;
+            *h = lept_hash_bytes(MY_STRING * LEPT_HASH_K, chars + nc, len);
+        }
+        if (!shallow) nc += len + 1;
+        return LEPT_PARSE_OK;
+    }
+
+    // 只数一下json处这个数组/对象有几个直接元素（第二遍用）
+    constexpr size_t count_elements(int (lept_static_parser::*f)(lept_value*, uint64_t*, size_t*)){
+        lept_static_parser s = *this;
+        size_t size = 0;
+        s.values = NULL; s.members = NULL; s.chars = NULL;
+        s.shallow = 1;
+        (s.*f)(NULL, NULL, &size);
+        return size;
+    }
+
+    constexpr int array(lept_value* v, uint64_t* h, size_t* count){
+        size_t size = 0, base = 0;
+        uint64_t hash = MY_ARRAY * LEPT_HASH_K, eh = 0;
+        int ret;
+        if (v) {
+            size_t n = count_elements(&lept_static_parser::array);
+            base = nv + 1;      // values[nv]留给哈希
+            nv += n ? n + 1 : 0;
+            v->type = MY_ARRAY;
+            v->e = n ? const_cast<lept_value*>(&fvalues[base].v) : NULL;
+            v->arrSize = n;
+            v->arrKind = LEPT_ARRAY_VALUES;
+        }
+        json++;
+        whitespace();
+        if (*json == ']')
+            json++;
+        else for (;;){
+            if ((ret = value(v ? &values[base + size].v : NULL, &eh)) != LEPT_PARSE_OK)
+                return ret;
+            if (v) hash = lept_hash_mix(hash + eh);
+            size++;
+            whitespace();
+            if (*json == ',') {
+                json++;
+                whitespace();
+            }
+            else if (*json == ']') {
+                json++;
+                break;
+            }
+            else
+                return LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        }
+        if (!v && !shallow) nv += size ? size + 1 : 0;
+        if (count) *count = size;
+        if (v) {
+            hash = lept_hash_mix(hash ^ size);
+            hash += hash == 0;
+            if (size) values[base - 1].cache.h = hash;
+            *h = hash;
+        }
+        return LEPT_PARSE_OK;
+    }
+
+    constexpr int object(lept_value* v, uint64_t* h, size_t* count){
+        size_t size = 0, base = 0, klen;
+        uint64_t hash = 0, vh = 0;
+        int ret;
+        if (v) {
+            size_t n = count_elements(&lept_static_parser::object);
+            base = nm + 1;
+            nm += n ? n + 1 : 0;
+            v->type = MY_OBJECT;
+            v->m = n ? const_cast<lept_member*>(&fmembers[base].m) : NULL;
+            v->objSize = n;
+        }
+        json++;
+        whitespace();
+        if (*json == '}')
+            json++;
+        else for (;;){
+            lept_member* m = v ? &members[base + size].m : NULL;
+            if (*json != '\"')
+                return LEPT_PARSE_MISS_KEY;
+            if ((ret = str_raw(&klen)) != LEPT_PARSE_OK)
+                return ret;
+            if (m) {
+                m->k = const_cast<char*>(fchars + nc);
+                m->klen = klen;
+            }
+            size_t key = nc;
+            if (!shallow) nc += klen + 1;
+            whitespace();
+            if (*json != ':')
+                return LEPT_PARSE_MISS_COLON;
+            json++;
+            whitespace();
+            if ((ret = value(m ? &m->v : NULL, &vh)) != LEPT_PARSE_OK)
+                return ret;
+            if (m)
+                hash += lept_hash_mix(lept_hash_bytes(MY_STRING, chars + key, klen) + vh * LEPT_HASH_K);
+            size++;
+            whitespace();
+            if (*json == ',') {
+                json++;
+                whitespace();
+            }
+            else if (*json == '}') {
+                json++;
+                break;
+            }
+            else
+                return LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            whitespace();
+        }
+        if (!v && !shallow) nm += size ? size + 1 : 0;
+        if (count) *count = size;
+        if (v) {
+            hash = lept_hash_mix(hash ^ (MY_OBJECT * LEPT_HASH_K) ^ size);
+            hash += hash == 0;
+            if (size) members[base - 1].cache.h = hash;
+            *h = hash;
+        }
+        return LEPT_PARSE_OK;
+    }
+
+    constexpr int value(lept_value* v, uint64_t* h){
+        int ret;
+        switch (*json) {
+            case '{': return object(v, h, NULL);
+            case '[': return array(v, h, NULL);
+            case 'n': ret = ntf(v, "null", MY_NULL); break;
+            case 't': ret = ntf(v, "true", MY_TRUE); break;
+            case 'f': ret = ntf(v, "false", MY_FALSE); break;
+            case '"': return str(v, h);
+            case '\0': return LEPT_PARSE_EXPECT_VALUE;
+            default: ret = number(v); break;
+        }
+        // 标量的哈希不缓存，这里算好只是给外层数组/对象用
+        if (v && ret == LEPT_PARSE_OK)
+            *h = v->type == MY_NUMBER ? lept_hash_number(v->n) : lept_hash_mix(v->type * LEPT_HASH_K);
+        return ret;
+    }
+
+    constexpr int parse(lept_value* root){
+        uint64_t h = 0;
+        int ret;
+        whitespace();
+        if ((ret = value(root, &h)) == LEPT_PARSE_OK) {
+            whitespace();
+            if (*json != '\0')
+                ret = LEPT_PARSE_ROOT_NOT_SINGULAR;
+        }
+        return ret;
+    }
+};
+
+// 第一遍的结果：错误码和各部分的大小（根节点占values[0]，每个非空数组/对象再多一格放哈希）
+struct lept_static_layout {
+    int ret;
+    size_t values, members, chars;
+};
+
+constexpr lept_static_layout lept_static_measure(const char* json){
+    lept_static_parser p = { json, NULL, NULL, NULL, NULL, NULL, NULL, 1, 0, 0, 0 };
+    int ret = p.parse(NULL);
+    return { ret, p.nv, p.nm, p.nc };
+}
+
+// 和lept_parse(v, json)的返回值相同，可以拿来static_assert
+constexpr int lept_static_check(const char* json){
+    return lept_static_measure(json).ret;
+}
+
+template <size_t NV, size_t NM, size_t NC>
+struct lept_static_storage {
+    lept_static_value_cell values[NV];
+    lept_static_member_cell members[NM ? NM : 1];
+    char chars[NC ? NC : 1];
+};
+
+template <size_t NV, size_t NM, size_t NC>
+constexpr lept_static_storage<NV, NM, NC> lept_static_build(const char* json, const lept_static_storage<NV, NM, NC>* self){
+    lept_static_storage<NV, NM, NC> r{};
+    lept_static_parser p = { json, r.values, r.members, r.chars, self->values, self->members, self->chars, 1, 0, 0, 0 };
+    p.parse(&r.values[0].v);
+    return r;
+}
+
+template <lept_literal S>
+struct lept_static_doc {
+    static constexpr lept_static_layout layout = lept_static_measure(S.s);
+    static_assert(layout.ret == LEPT_PARSE_OK, "invalid JSON literal: layout.ret is the lept_parse error code");
+    using storage = lept_static_storage<layout.values, layout.members, layout.chars>;
+};
+
+// 初始化的时候要用到自己的地址，所以不能放在类里面；字面量不合法时只报上面那一个static_assert
+template <lept_literal S>
+inline constexpr typename lept_static_doc<S>::storage lept_static_data =
+    lept_static_doc<S>::layout.ret == LEPT_PARSE_OK ? lept_static_build(S.s, &lept_static_data<S>) : typename lept_static_doc<S>::storage{};
+
+template <lept_literal S>
+constexpr const lept_value* lept_static_json(){
+    return &lept_static_data<S>.values[0].v;
+}
+
+#endif
@@ -1,7 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "leptjson.h"
+#include "leptjson_bind.h"
+#include "leptjson_coro.h"
+#include "leptjson_static.h"
 
 static int main_ret = 0;
 static int test_count = 0;
@@ -30,6 +34,8 @@ static int test_pass = 0;
         v.type = MY_FALSE;\
         EXPECT_EQ_INT(error, lept_parse(&v, json));\
         EXPECT_EQ_INT(MY_NULL, lept_get_type(&v));\
+        EXPECT_EQ_INT(error, lept_validate(json, strlen(json)));\
+        static_assert(lept_static_check(json) == (error), json);\
     }while(0)
 
 #define TEST_PARSE_NTF(test_type, flag)\
@@ -55,6 +61,8 @@ static int test_pass = 0;
         EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));\
         EXPECT_EQ_INT(MY_NUMBER, lept_get_type(&v));\
         EXPECT_EQ_DOUBLE(expect, lept_get_number(&v));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate(json, strlen(json)));\
+        EXPECT_EQ_DOUBLE(expect, lept_get_number(lept_static_json<json>()));\
         lept_free(&v);\
     }while(0)
 
@@ -66,6 +74,8 @@ static int test_pass = 0;
         EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));\
         EXPECT_EQ_INT(MY_STRING, lept_get_type(&v));\
         EXPECT_EQ_STR(expect, lept_get_str(&v), lept_get_str_len(&v));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate(json, strlen(json)));\
+        EXPECT_EQ_STR(expect, lept_get_str(lept_static_json<json>()), lept_get_str_len(lept_static_json<json>()));\
         lept_free(&v);\
     }while(0)
 
@@ -162,6 +172,10 @@ static void test_parse_str(){
     TEST_STR("Hello\nWorld", "\"Hello\\nWorld\"");
     TEST_STR("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
 #endif
+    TEST_STR("\xC3\xA9" "a", "\"\\u00e9a\"");   /* \u后面正好4位，紧跟着的十六进制字符不算 */
+    TEST_STR("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");
+    TEST_STR("a long string that is longer than sixteen bytes \xE4\xB8\xAD\n",
+        "\"a long string that is longer than sixteen bytes \xE4\xB8\xAD\\n\"");
 }
 
 static void test_parse_missing_quotation_mark() {
@@ -243,6 +257,76 @@ static void test_parse_arr(){
 
 }
 
+static void test_parse_number_array(){
+    const double* d;
+    size_t len, i;
+    lept_value v, v2;
+    lept_parser p;
+
+    /* lept_parse不产生紧凑数组 */
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "[ 1 , -2.5 , 3e2 ]"));
+    EXPECT_EQ_INT(0, lept_get_number_array(&v, &d, &len));
+    EXPECT_EQ_DOUBLE(-2.5, lept_get_array_number(&v, 1));
+    lept_free(&v);
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_packed(&v, "[ 1 , -2.5 , 3e2 ]"));
+    EXPECT_EQ_INT(1, lept_get_number_array(&v, &d, &len));
+    EXPECT_EQ_SIZE_T(3, len);
+    EXPECT_EQ_DOUBLE(1.0, d[0]);
+    EXPECT_EQ_DOUBLE(-2.5, d[1]);
+    EXPECT_EQ_DOUBLE(300.0, d[2]);
+    EXPECT_EQ_DOUBLE(-2.5, lept_get_array_number(&v, 1));
+    /* 紧凑和展开之后的哈希、相等都不变 */
+    lept_init(&v2);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v2, "[1,-2.5,300]"));
+    EXPECT_EQ_INT(1, lept_hash(&v) == lept_hash(&v2));
+    EXPECT_EQ_INT(MY_NUMBER, lept_get_type(lept_get_array_element(&v2, 0)));
+    EXPECT_EQ_INT(0, lept_get_number_array(&v2, &d, &len));
+    EXPECT_EQ_INT(1, lept_is_equal(&v, &v2));
+    EXPECT_EQ_INT(1, lept_is_equal(&v2, &v));
+    /* 要按元素访问得先显式展开，展开之前拿不到lept_value */
+    EXPECT_EQ_INT(1, lept_get_array_element(&v, 0) == NULL);
+    lept_unpack_array(&v);
+    EXPECT_EQ_DOUBLE(300.0, lept_get_number(lept_get_array_element(&v, 2)));
+    EXPECT_EQ_INT(0, lept_get_number_array(&v, &d, &len));
+    EXPECT_EQ_INT(1, lept_hash(&v) == lept_hash(&v2));
+    lept_unpack_array(&v);
+    lept_free(&v2);
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(&v));
+    EXPECT_EQ_DOUBLE(-2.5, lept_get_array_number(&v, 1));
+    lept_free(&v);
+
+    /* 中途遇到不是数字的元素 */
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_packed(&v, "[1,2,3,\"a\",4]"));
+    EXPECT_EQ_INT(0, lept_get_number_array(&v, &d, &len));
+    for (i = 0; i < 5; i++)
+        EXPECT_EQ_INT(i == 3 ? MY_STRING : MY_NUMBER, lept_get_type(lept_get_array_element(&v, i)));
+    EXPECT_EQ_DOUBLE(3.0, lept_get_number(lept_get_array_element(&v, 2)));
+    EXPECT_EQ_DOUBLE(4.0, lept_get_number(lept_get_array_element(&v, 4)));
+    lept_free(&v);
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_packed(&v, "[\"a\",1,2]"));
+    EXPECT_EQ_INT(0, lept_get_number_array(&v, &d, &len));
+    lept_free(&v);
+
+    /* 分段解析也一样 */
+    lept_init(&v);
+    lept_parser_init(&p, &v, "[[1,2],[3,[]]]");
+    p.packNumbers = 1;
+    while (lept_parse_step(&p, 1) == LEPT_PARSE_YIELD);
+    EXPECT_EQ_INT(1, lept_get_number_array(lept_get_array_element(&v, 0), &d, &len));
+    EXPECT_EQ_SIZE_T(2, len);
+    EXPECT_EQ_INT(0, lept_get_number_array(lept_get_array_element(&v, 1), &d, &len));
+    lept_free(&v);
+
+    TEST_ERROR(LEPT_PARSE_INVALID_VALUE, "[1,2,x]");
+    TEST_ERROR(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1,2,3");
+}
+
 static void test_parse_miss_comma_or_square_bracket() {
 #if 1
     TEST_ERROR(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1");
@@ -282,6 +366,64 @@ static void test_access_string(){
     lept_free(&v);
 }
 
+static void test_parse_obj(){
+    lept_value v;
+    size_t i;
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, " { } "));
+    EXPECT_EQ_INT(MY_OBJECT, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(0, lept_get_object_size(&v));
+    lept_free(&v);
+
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v,
+        " { "
+        "\"n\" : null , "
+        "\"f\" : false , "
+        "\"t\" : true , "
+        "\"i\" : 123 , "
+        "\"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ],"
+        "\"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 }"
+        " } "
+    ));
+    EXPECT_EQ_INT(MY_OBJECT, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(7, lept_get_object_size(&v));
+    EXPECT_EQ_STR("n", lept_get_object_key(&v, 0), lept_get_object_key_length(&v, 0));
+    EXPECT_EQ_INT(MY_NULL,   lept_get_type(lept_get_object_value(&v, 0)));
+    EXPECT_EQ_STR("f", lept_get_object_key(&v, 1), lept_get_object_key_length(&v, 1));
+    EXPECT_EQ_INT(MY_FALSE,  lept_get_type(lept_get_object_value(&v, 1)));
+    EXPECT_EQ_STR("t", lept_get_object_key(&v, 2), lept_get_object_key_length(&v, 2));
+    EXPECT_EQ_INT(MY_TRUE,   lept_get_type(lept_get_object_value(&v, 2)));
+    EXPECT_EQ_STR("i", lept_get_object_key(&v, 3), lept_get_object_key_length(&v, 3));
+    EXPECT_EQ_INT(MY_NUMBER, lept_get_type(lept_get_object_value(&v, 3)));
+    EXPECT_EQ_DOUBLE(123.0, lept_get_number(lept_get_object_value(&v, 3)));
+    EXPECT_EQ_STR("s", lept_get_object_key(&v, 4), lept_get_object_key_length(&v, 4));
+    EXPECT_EQ_INT(MY_STRING, lept_get_type(lept_get_object_value(&v, 4)));
+    EXPECT_EQ_STR("abc", lept_get_str(lept_get_object_value(&v, 4)), lept_get_str_len(lept_get_object_value(&v, 4)));
+    EXPECT_EQ_STR("a", lept_get_object_key(&v, 5), lept_get_object_key_length(&v, 5));
+    EXPECT_EQ_INT(MY_ARRAY, lept_get_type(lept_get_object_value(&v, 5)));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(lept_get_object_value(&v, 5)));
+    for (i = 0; i < 3; i++) {
+        lept_value* e = lept_get_array_element(lept_get_object_value(&v, 5), i);
+        EXPECT_EQ_INT(MY_NUMBER, lept_get_type(e));
+        EXPECT_EQ_DOUBLE(i + 1.0, lept_get_number(e));
+    }
+    EXPECT_EQ_STR("o", lept_get_object_key(&v, 6), lept_get_object_key_length(&v, 6));
+    {
+        lept_value* o = lept_get_object_value(&v, 6);
+        EXPECT_EQ_INT(MY_OBJECT, lept_get_type(o));
+        for (i = 0; i < 3; i++) {
+            lept_value* ov = lept_get_object_value(o, i);
+            EXPECT_EQ_INT(1, '1' + i == lept_get_object_key(o, i)[0]);
+            EXPECT_EQ_SIZE_T(1, lept_get_object_key_length(o, i));
+            EXPECT_EQ_INT(MY_NUMBER, lept_get_type(ov));
+            EXPECT_EQ_DOUBLE(i + 1.0, lept_get_number(ov));
+        }
+    }
+    lept_free(&v);
+}
+
 static void test_parse_miss_key() {
     TEST_ERROR(LEPT_PARSE_MISS_KEY, "{:1,");
     TEST_ERROR(LEPT_PARSE_MISS_KEY, "{1:1,");
@@ -305,6 +447,765 @@ static void test_parse_miss_comma_or_curly_bracket() {
     TEST_ERROR(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
 }
 
+struct bind_point { double x, y; };
+struct bind_msg {
+    int id;
+    long long ts;
+    bool ok;
+    std::string name;
+    bind_point pos;
+};
+template <> struct lept_bind<bind_point> {
+    static constexpr lept_field fields[] = { LEPT_FIELD(bind_point, x), LEPT_FIELD(bind_point, y) };
+};
+template <> struct lept_bind<bind_msg> {
+    static constexpr lept_field fields[] = {
+        LEPT_FIELD(bind_msg, id), LEPT_FIELD(bind_msg, ts), LEPT_FIELD(bind_msg, ok),
+        LEPT_FIELD(bind_msg, name), LEPT_FIELD(bind_msg, pos)
+    };
+};
+
+static void test_parse_bind(){
+    bind_msg m = { 0, 0, false, "", { 0.0, 0.0 } };
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_into(&m,
+        " { \"pos\" : { \"y\" : -2.5 , \"x\" : 1 } , \"skip\" : [ { \"a\" : \"\\u00e9\" } , 1e3 , null ] ,"
+        " \"name\" : \"He\\nllo\" , \"id\" : 42 , \"ts\" : 1666000000000 , \"ok\" : true } "));
+    EXPECT_EQ_INT(42, m.id);
+    EXPECT_EQ_INT(1, m.ts == 1666000000000LL);
+    EXPECT_EQ_INT(true, m.ok);
+    EXPECT_EQ_STR("He\nllo", m.name.c_str(), m.name.size());
+    EXPECT_EQ_DOUBLE(1.0, m.pos.x);
+    EXPECT_EQ_DOUBLE(-2.5, m.pos.y);
+
+    // null不改动字段
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_into(&m, "{\"id\":null,\"name\":\"x\"}"));
+    EXPECT_EQ_INT(42, m.id);
+    EXPECT_EQ_STR("x", m.name.c_str(), m.name.size());
+
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"id\":\"42\"}"));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"id\":1.5}"));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"ok\":0}"));
+
+    // long long不经过double：2^53以上的整数也要原样读出来
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_into(&m, "{\"ts\":9007199254740993}"));
+    EXPECT_EQ_INT(1, m.ts == 9007199254740993LL);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_into(&m, "{\"ts\":9223372036854775807}"));
+    EXPECT_EQ_INT(1, m.ts == INT64_MAX);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_into(&m, "{\"ts\":-9223372036854775808}"));
+    EXPECT_EQ_INT(1, m.ts == INT64_MIN);
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"ts\":9223372036854775808}"));
+    EXPECT_EQ_INT(1, m.ts == INT64_MIN);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_into(&m, "{\"ts\":1.5e3}"));
+    EXPECT_EQ_INT(1, m.ts == 1500);
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"ts\":9007199254740993.0}"));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"ts\":1e19}"));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"ts\":0.5}"));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "{\"pos\":[1,2]}"));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_parse_into(&m, "[]"));
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_parse_into(&m, " "));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_parse_into(&m, "{} x"));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_parse_into(&m, "{\"skip\":[tru]}"));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_STRING_CHAR, lept_parse_into(&m, "{\"name\":\"a\x01\"}"));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_into(&m, "{\"skip\":[1 2]}"));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_parse_into(&m, "{\"id\":1"));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_KEY, lept_parse_into(&m, "{\"id\":1,}"));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_parse_into(&m, "{\"skip\"}"));
+
+    // 编译期生成的哈希表：每个键都在自己的槽里，前缀、多一个字符、空键都找不到
+    for (size_t i = 0; i < lept_bind_index<bind_msg>::n; ++i){
+        const lept_field* f = &lept_bind<bind_msg>::fields[i];
+        const lept_field_index* ix = &lept_bind_index<bind_msg>::index;
+        EXPECT_EQ_INT((int)i + 1, ix->slots[lept_field_hash(f->k, f->klen, ix->seed) & ix->mask]);
+    }
+    m.id = 0;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_into(&m, "{\"i\":\"x\",\"idd\":\"x\",\"\":\"x\",\"Id\":\"x\",\"id\":7}"));
+    EXPECT_EQ_INT(7, m.id);
+
+    // 不带哈希表的C接口按顺序找
+    m.pos.x = 0;
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_fields(&m.pos, lept_bind<bind_point>::fields, 2, NULL, "{\"y\":1,\"z\":0,\"x\":3}"));
+    EXPECT_EQ_DOUBLE(3.0, m.pos.x);
+    EXPECT_EQ_DOUBLE(1.0, m.pos.y);
+}
+
+struct stats_hook_count { int enter[MY_OBJECT + 1], leave[MY_OBJECT + 1]; };
+
+static void stats_hook(void* ud, lept_type type, int leave){
+    stats_hook_count* h = (stats_hook_count*)ud;
+    if (leave) h->leave[type]++;
+    else h->enter[type]++;
+}
+
+static void test_parse_stats(){
+    const char* json = " [ 1 , \"ab\" , [ null , true , false , [ -2.5 ] ] , { } ] ";
+    stats_hook_count h;
+    lept_parse_stats st;
+    lept_value v;
+    memset(&h, 0, sizeof(h));
+    st.hook = stats_hook;
+    st.ud = &h;
+    st.bytes = 12345;   // 应该被清零重填
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_with_stats(&v, json, &st));
+    EXPECT_EQ_SIZE_T(strlen(json), st.bytes);
+    EXPECT_EQ_SIZE_T(1, st.nodes[MY_NULL]);
+    EXPECT_EQ_SIZE_T(1, st.nodes[MY_TRUE]);
+    EXPECT_EQ_SIZE_T(1, st.nodes[MY_FALSE]);
+    EXPECT_EQ_SIZE_T(2, st.nodes[MY_NUMBER]);
+    EXPECT_EQ_SIZE_T(1, st.nodes[MY_STRING]);
+    EXPECT_EQ_SIZE_T(3, st.nodes[MY_ARRAY]);
+    EXPECT_EQ_SIZE_T(1, st.nodes[MY_OBJECT]);
+    EXPECT_EQ_SIZE_T(3, st.maxDepth);
+    EXPECT_EQ_SIZE_T(6 * sizeof(lept_value), st.stackPeak);  // 外层2个 + 内层4个
+    EXPECT_EQ_SIZE_T(1, st.reallocs);  // 第一次分配栈也是realloc
+    EXPECT_EQ_SIZE_T(5, st.allocs);   // 栈1次 + 字符串1次 + 3个非空数组
+    EXPECT_EQ_INT(3, h.enter[MY_ARRAY]);
+    EXPECT_EQ_INT(3, h.leave[MY_ARRAY]);
+    EXPECT_EQ_INT(1, h.enter[MY_OBJECT]);
+    EXPECT_EQ_INT(2, h.enter[MY_NUMBER]);
+    EXPECT_EQ_INT(1, h.leave[MY_STRING]);
+    EXPECT_EQ_INT(0, h.enter[MY_NULL]);
+    lept_free(&v);
+
+    // 对象的键也按字符串计时，但不算进nodes
+    memset(&h, 0, sizeof(h));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse_with_stats(&v, "{\"a\":\"x\",\"b\":{\"c\":1}}", &st));
+    EXPECT_EQ_SIZE_T(1, st.nodes[MY_STRING]);
+    EXPECT_EQ_INT(4, h.enter[MY_STRING]);
+    EXPECT_EQ_INT(4, h.leave[MY_STRING]);
+    EXPECT_EQ_INT(2, h.enter[MY_OBJECT]);
+    lept_free(&v);
+
+    // 出错时bytes是出错的位置
+    st.hook = NULL;
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_parse_with_stats(&v, "[1 2]", &st));
+    EXPECT_EQ_SIZE_T(3, st.bytes);
+    EXPECT_EQ_SIZE_T(1, st.nodes[MY_NUMBER]);
+}
+
+#define TEST_EQUAL(json1, json2, equality) \
+    do {\
+        lept_value v1, v2;\
+        lept_init(&v1);\
+        lept_init(&v2);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v1, json1));\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v2, json2));\
+        EXPECT_EQ_INT(equality, lept_is_equal(&v1, &v2));\
+        EXPECT_EQ_INT(equality, lept_is_equal(&v2, &v1));\
+        if (equality)\
+            EXPECT_EQ_INT(1, lept_hash(&v1) == lept_hash(&v2));\
+        EXPECT_EQ_INT(equality, lept_is_equal(&v1, &v2));   /* 这次两边都有缓存的哈希了 */\
+        lept_free(&v1);\
+        lept_free(&v2);\
+    } while(0)
+
+static void test_equal() {
+    TEST_EQUAL("true", "true", 1);
+    TEST_EQUAL("true", "false", 0);
+    TEST_EQUAL("false", "false", 1);
+    TEST_EQUAL("null", "null", 1);
+    TEST_EQUAL("null", "0", 0);
+    TEST_EQUAL("123", "123", 1);
+    TEST_EQUAL("123", "456", 0);
+    TEST_EQUAL("0", "-0", 1);
+    TEST_EQUAL("\"abc\"", "\"abc\"", 1);
+    TEST_EQUAL("\"abc\"", "\"abcd\"", 0);
+    TEST_EQUAL("\"abcdefghijk\"", "\"abcdefghijx\"", 0);
+    TEST_EQUAL("[]", "[]", 1);
+    TEST_EQUAL("[]", "{}", 0);
+    TEST_EQUAL("[]", "null", 0);
+    TEST_EQUAL("[1,2,3]", "[1,2,3]", 1);
+    TEST_EQUAL("[1,2,3]", "[1,2,3,4]", 0);
+    TEST_EQUAL("[1,2,3]", "[3,2,1]", 0);
+    TEST_EQUAL("[[]]", "[[]]", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2}", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"b\":2,\"a\":1}", 1);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":3}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"b\":2,\"c\":3}", 0);
+    TEST_EQUAL("{\"a\":1,\"b\":2}", "{\"a\":1,\"c\":2}", 0);
+    TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":{}}}}", 1);
+    TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
+    /* 重复的键按多重集合比较 */
+    TEST_EQUAL("{\"a\":1,\"a\":2}", "{\"a\":2,\"a\":1}", 1);
+    TEST_EQUAL("{\"a\":1,\"a\":2}", "{\"a\":1,\"a\":1}", 0);
+    /* 成员多的时候走排序的路径 */
+    TEST_EQUAL(
+        "{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9,"
+        "\"j\":10,\"k\":11,\"l\":12,\"m\":13,\"n\":14,\"o\":15,\"p\":16,\"q\":[17],\"q\":{}}",
+        "{\"q\":{},\"q\":[17],\"p\":16,\"o\":15,\"n\":14,\"m\":13,\"l\":12,\"k\":11,\"j\":10,"
+        "\"i\":9,\"h\":8,\"g\":7,\"f\":6,\"e\":5,\"d\":4,\"c\":3,\"b\":2,\"a\":1}", 1);
+    TEST_EQUAL(
+        "{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9,"
+        "\"j\":10,\"k\":11,\"l\":12,\"m\":13,\"n\":14,\"o\":15,\"p\":16,\"q\":17,\"q\":17}",
+        "{\"q\":17,\"r\":17,\"p\":16,\"o\":15,\"n\":14,\"m\":13,\"l\":12,\"k\":11,\"j\":10,"
+        "\"i\":9,\"h\":8,\"g\":7,\"f\":6,\"e\":5,\"d\":4,\"c\":3,\"b\":2,\"a\":1}", 0);
+}
+
+static void test_hash() {
+    lept_value v;
+    uint64_t h;
+    /* 哈希缓存不占lept_value的地方：64位下还是24个字节 */
+    if (sizeof(void*) == 8)
+        EXPECT_EQ_SIZE_T(24, sizeof(lept_value));
+    /* 字节总是按小端拼成64位：大端平台上的哈希也一样 */
+    static_assert(lept_hash_bytes(0, "\x01\x02", 2) == lept_hash_mix(2 * LEPT_HASH_K ^ 0x0201), "little-endian words");
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, "[1,\"1\",[1],{\"1\":1}]"));
+    h = lept_hash(&v);
+    EXPECT_EQ_INT(1, h != 0 && h == lept_hash(&v));
+    /* 类型不同的值哈希不同 */
+    EXPECT_EQ_INT(1, lept_hash(lept_get_array_element(&v, 0)) != lept_hash(lept_get_array_element(&v, 1)));
+    EXPECT_EQ_INT(1, lept_hash(lept_get_array_element(&v, 2)) != lept_hash(lept_get_array_element(&v, 3)));
+    lept_free(&v);
+}
+
+// 分段解析的结果要和lept_parse完全一样
+#define TEST_STEP(json, max_bytes)\
+    do{\
+        lept_value v1, v2;\
+        lept_parser p;\
+        int ret;\
+        lept_init(&v1);\
+        v2.type = MY_FALSE;\
+        lept_parser_init(&p, &v2, json);\
+        while ((ret = lept_parse_step(&p, max_bytes)) == LEPT_PARSE_YIELD);\
+        EXPECT_EQ_INT(lept_parse(&v1, json), ret);\
+        EXPECT_EQ_INT(1, lept_is_equal(&v1, &v2));\
+        lept_free(&v1);\
+        lept_free(&v2);\
+    }while(0)
+
+static void test_parse_step(){
+    static const char* jsons[] = {
+        "null", " 123 ", "\"abc\"", "[]", " { } ", "[1,[2,[3,[4]]],{}]",
+        " { \"a\" : [ 1 , { \"b\" : null } ] , \"c\" : \"d\" , \"e\" : { } } ",
+        "", "[1", "[1}", "[1 2", "[[]", "{:1", "{\"a\"}", "{\"a\":1", "{\"a\":[1,{\"b\":tru}]}",
+        "[\"a\x01\"]", "{\"a\":{}", "[1] x", "[1e309]", "{\"\\v\":1}"
+    };
+    size_t i;
+    for (i = 0; i < sizeof(jsons) / sizeof(jsons[0]); i++){
+        TEST_STEP(jsons[i], 0);
+        TEST_STEP(jsons[i], 4);
+        TEST_STEP(jsons[i], 1 << 20);
+    }
+
+    // 预算小的时候确实会分好几次
+    {
+        lept_value v;
+        lept_parser p;
+        int steps = 0;
+        lept_init(&v);
+        lept_parser_init(&p, &v, "[1,2,3,4,5,6,7,8]");
+        while (lept_parse_step(&p, 4) == LEPT_PARSE_YIELD)
+            steps++;
+        EXPECT_EQ_INT(1, steps >= 3);
+        EXPECT_EQ_SIZE_T(8, lept_get_array_size(&v));
+        lept_free(&v);
+    }
+
+    // 中途放弃
+    {
+        lept_value v;
+        lept_parser p;
+        lept_init(&v);
+        lept_parser_init(&p, &v, "{\"a\":[1,{\"b\":\"c\"},2,3,4,5,6]}");
+        EXPECT_EQ_INT(LEPT_PARSE_YIELD, lept_parse_step(&p, 12));
+        lept_parser_free(&p);
+        EXPECT_EQ_INT(MY_NULL, lept_get_type(&v));
+    }
+}
+
+static void test_parse_async(){
+    lept_value v;
+    int resumes = 0;
+    lept_init(&v);
+    {
+        lept_parse_task t = lept_parse_async(&v, "[[1,2],[3,4],[5,6]]", 2);
+        EXPECT_EQ_INT(LEPT_PARSE_YIELD, t.result());
+        while (t.resume())
+            resumes++;
+        EXPECT_EQ_INT(LEPT_PARSE_OK, t.result());
+    }
+    EXPECT_EQ_INT(1, resumes >= 2);
+    EXPECT_EQ_INT(MY_ARRAY, lept_get_type(&v));
+    EXPECT_EQ_SIZE_T(3, lept_get_array_size(&v));
+    lept_free(&v);
+
+    // 没解析完就销毁task
+    lept_init(&v);
+    {
+        lept_parse_task t = lept_parse_async(&v, "[[1,2],[3,4],[5,6]]", 2);
+        t.resume();
+        EXPECT_EQ_INT(0, t.done());
+    }
+    EXPECT_EQ_INT(MY_NULL, lept_get_type(&v));
+}
+
+#define TEST_ROUNDTRIP(json)\
+    do {\
+        lept_value v;\
+        char* json2;\
+        size_t length;\
+        lept_init(&v);\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));\
+        json2 = lept_stringify(&v, &length);\
+        EXPECT_EQ_STR(json, json2, length);\
+        lept_free(&v);\
+        free(json2);\
+    } while(0)
+
+static void test_stringify() {
+    TEST_ROUNDTRIP("null");
+    TEST_ROUNDTRIP("false");
+    TEST_ROUNDTRIP("true");
+    TEST_ROUNDTRIP("0");
+    TEST_ROUNDTRIP("-0");
+    TEST_ROUNDTRIP("1");
+    TEST_ROUNDTRIP("-1");
+    TEST_ROUNDTRIP("1.5");
+    TEST_ROUNDTRIP("-1.5");
+    TEST_ROUNDTRIP("3.25");
+    TEST_ROUNDTRIP("1e+20");
+    TEST_ROUNDTRIP("1.234e+20");
+    TEST_ROUNDTRIP("1.234e-20");
+    TEST_ROUNDTRIP("1.0000000000000002"); /* the smallest number > 1 */
+    TEST_ROUNDTRIP("4.94065645841247e-324"); /* minimum denormal */
+    TEST_ROUNDTRIP("0.1");
+    TEST_ROUNDTRIP("1e+300");
+    TEST_ROUNDTRIP("0.30000000000000004");
+    TEST_ROUNDTRIP("1.7976931348623157e+308");  /* Max double */
+    TEST_ROUNDTRIP("\"\"");
+    TEST_ROUNDTRIP("\"Hello\"");
+    TEST_ROUNDTRIP("\"Hello\\nWorld\"");
+    TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+    TEST_ROUNDTRIP("\"Hello\\u0000World\\u001F\"");
+    TEST_ROUNDTRIP("[]");
+    TEST_ROUNDTRIP("[null,false,true,123,\"abc\",[1,2,3]]");
+    TEST_ROUNDTRIP("{}");
+    TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
+
+    /* 比LEPT_WRITER_MAX_DEPTH深的树也要能写出来 */
+    {
+        const size_t depth = LEPT_WRITER_MAX_DEPTH * 4;
+        char* json = (char*)malloc(depth * 8 + 2);
+        char* json2;
+        size_t i, n = 0, length = 0;
+        lept_value v;
+        for (i = 0; i < depth; ++i) { memcpy(json + n, "{\"a\":[", 6); n += 6; }
+        json[n++] = '1';
+        for (i = 0; i < depth; ++i) { json[n++] = ']'; json[n++] = '}'; }
+        json[n] = '\0';
+        lept_init(&v);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, json));
+        json2 = lept_stringify(&v, &length);
+        EXPECT_EQ_SIZE_T(n, length);
+        EXPECT_EQ_INT(1, json2 != NULL && memcmp(json, json2, n) == 0);
+        lept_free(&v);
+        free(json2);
+        free(json);
+    }
+}
+
+// 写进内存的sink，可以设定写多少次之后失败
+typedef struct { char buf[8192]; size_t len; int calls, failAt; } test_sink;
+
+static int test_sink_write(void* ud, const char* data, size_t len){
+    test_sink* s = (test_sink*)ud;
+    if (++s->calls == s->failAt || s->len + len > sizeof(s->buf))
+        return 1;
+    memcpy(s->buf + s->len, data, len);
+    s->len += len;
+    return 0;
+}
+
+static void test_writer() {
+    static test_sink s;
+    lept_writer w;
+    size_t i;
+    FILE* f;
+    char buf[64];
+
+    memset(&s, 0, sizeof(s));
+    lept_writer_init(&w, test_sink_write, &s);
+    lept_write_begin_object(&w);
+    lept_write_key(&w, "a", 1);
+    lept_write_begin_array(&w);
+    lept_write_number(&w, 1);
+    lept_write_string(&w, "x\"y", 3);
+    lept_write_null(&w);
+    lept_write_bool(&w, 1);
+    lept_write_begin_object(&w);
+    lept_write_end_object(&w);
+    lept_write_end_array(&w);
+    lept_write_key(&w, "b\n", 2);
+    lept_write_number(&w, HUGE_VAL);
+    lept_write_end_object(&w);
+    EXPECT_EQ_INT(LEPT_WRITE_OK, lept_writer_finish(&w));
+    EXPECT_EQ_STR("{\"a\":[1,\"x\\\"y\",null,true,{}],\"b\\n\":null}", s.buf, s.len);
+    EXPECT_EQ_INT(1, s.calls);
+
+    // 超过缓冲区大小会分几次交给sink
+    memset(&s, 0, sizeof(s));
+    lept_writer_init(&w, test_sink_write, &s);
+    lept_write_begin_array(&w);
+    for (i = 0; i < 1000; i++)
+        lept_write_number(&w, 1234567);
+    lept_write_end_array(&w);
+    EXPECT_EQ_INT(LEPT_WRITE_OK, lept_writer_finish(&w));
+    EXPECT_EQ_SIZE_T(2 + 1000 * 7 + 999, s.len);
+    EXPECT_EQ_INT(1, s.calls > 1);
+    EXPECT_EQ_INT(1, s.buf[0] == '[' && s.buf[s.len - 1] == ']');
+
+    memset(&s, 0, sizeof(s));
+    s.failAt = 1;
+    lept_writer_init(&w, test_sink_write, &s);
+    lept_write_string(&w, "abc", 3);
+    EXPECT_EQ_INT(1, w.hasRoot);    // 再写一个值就会assert
+    EXPECT_EQ_INT(LEPT_WRITE_SINK_ERROR, lept_writer_finish(&w));
+
+    memset(&s, 0, sizeof(s));
+    lept_writer_init(&w, test_sink_write, &s);
+    for (i = 0; i <= LEPT_WRITER_MAX_DEPTH; i++)
+        lept_write_begin_array(&w);
+    EXPECT_EQ_INT(LEPT_WRITE_TOO_DEEP, lept_writer_finish(&w));
+
+    // 写到文件描述符
+    if ((f = tmpfile()) != NULL){
+        lept_writer_init_fd(&w, fileno(f));
+        lept_write_begin_array(&w);
+        lept_write_number(&w, -2.5);
+        lept_write_end_array(&w);
+        EXPECT_EQ_INT(LEPT_WRITE_OK, lept_writer_finish(&w));
+        rewind(f);
+        i = fread(buf, 1, sizeof(buf), f);
+        EXPECT_EQ_STR("[-2.5]", buf, i);
+        fclose(f);
+    }
+}
+
+#define COLUMN_VALID(col, i) (((col).valid[(i) >> 3] >> ((i) & 7)) & 1)
+#define COLUMN_BOOL(col, i) (((col).bools[(i) >> 3] >> ((i) & 7)) & 1)
+#define EXPECT_EQ_COLUMN_STR(expect, col, i) \
+    EXPECT_EQ_STR(expect, (col).chars + (col).offsets[i], (col).offsets[(i) + 1] - (col).offsets[i])
+
+static void test_extract_columns(){
+    lept_column cols[3] = {
+        { "id", 2, LEPT_COLUMN_NUMBER },
+        { "name", 4, LEPT_COLUMN_STRING },
+        { "ok", 2, LEPT_COLUMN_BOOL }
+    };
+    size_t rows, i;
+    char buf[64];
+    std::string big;
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_extract_columns(
+        " [ { \"id\" : 1 , \"name\" : \"a\" , \"ok\" : true , \"x\" : { \"y\" : [ 1 ] } } ,"
+        " { \"ok\" : false , \"id\" : 2 } ,"
+        " { \"name\" : \"b\\nc\" , \"id\" : null } ,"
+        " { \"name\" : \"first\" , \"name\" : \"dd\" } ] ", cols, 3, &rows));
+    EXPECT_EQ_SIZE_T(4, rows);
+    EXPECT_EQ_INT(1, COLUMN_VALID(cols[0], 0));
+    EXPECT_EQ_INT(1, COLUMN_VALID(cols[0], 1));
+    EXPECT_EQ_INT(0, COLUMN_VALID(cols[0], 2));
+    EXPECT_EQ_INT(0, COLUMN_VALID(cols[0], 3));
+    EXPECT_EQ_DOUBLE(1.0, cols[0].numbers[0]);
+    EXPECT_EQ_DOUBLE(2.0, cols[0].numbers[1]);
+    EXPECT_EQ_INT(1, COLUMN_VALID(cols[1], 0));
+    EXPECT_EQ_INT(0, COLUMN_VALID(cols[1], 1));
+    EXPECT_EQ_INT(1, COLUMN_VALID(cols[1], 2));
+    EXPECT_EQ_INT(1, COLUMN_VALID(cols[1], 3));
+    EXPECT_EQ_COLUMN_STR("a", cols[1], 0);
+    EXPECT_EQ_COLUMN_STR("", cols[1], 1);
+    EXPECT_EQ_COLUMN_STR("b\nc", cols[1], 2);
+    EXPECT_EQ_COLUMN_STR("dd", cols[1], 3);    /* 重复的键后面的覆盖前面的 */
+    EXPECT_EQ_SIZE_T(6, cols[1].charsSize);
+    EXPECT_EQ_INT(1, COLUMN_VALID(cols[2], 0));
+    EXPECT_EQ_INT(1, COLUMN_VALID(cols[2], 1));
+    EXPECT_EQ_INT(0, COLUMN_VALID(cols[2], 2));
+    EXPECT_EQ_INT(1, COLUMN_BOOL(cols[2], 0));
+    EXPECT_EQ_INT(0, COLUMN_BOOL(cols[2], 1));
+    lept_free_columns(cols, 3);
+
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_extract_columns("[]", cols, 3, &rows));
+    EXPECT_EQ_SIZE_T(0, rows);
+    /* 没有行也有offsets[rows] */
+    EXPECT_EQ_INT(1, cols[1].offsets != NULL);
+    EXPECT_EQ_SIZE_T(0, cols[1].offsets[rows]);
+    lept_free_columns(cols, 3);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_extract_columns_ndjson(" \n\n ", cols, 3, &rows));
+    EXPECT_EQ_SIZE_T(0, rows);
+    EXPECT_EQ_INT(1, cols[1].offsets != NULL);
+    EXPECT_EQ_SIZE_T(0, cols[1].offsets[rows]);
+    lept_free_columns(cols, 3);
+
+    /* NDJSON，顺便让缓冲区扩容几次 */
+    for (i = 0; i < 1000; i++){
+        sprintf(buf, "{\"id\":%u,\"name\":\"n%u\"}\r\n\n", (unsigned)i, (unsigned)i);
+        big += buf;
+    }
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_extract_columns_ndjson(big.c_str(), cols, 3, &rows));
+    EXPECT_EQ_SIZE_T(1000, rows);
+    EXPECT_EQ_DOUBLE(999.0, cols[0].numbers[999]);
+    EXPECT_EQ_COLUMN_STR("n500", cols[1], 500);
+    EXPECT_EQ_INT(0, COLUMN_VALID(cols[2], 999));
+    lept_free_columns(cols, 3);
+
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_extract_columns("[{\"id\":\"1\"}]", cols, 3, &rows));
+    EXPECT_EQ_SIZE_T(0, rows);
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_extract_columns("[1]", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_TYPE_MISMATCH, lept_extract_columns("{}", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_extract_columns("", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_extract_columns("[{\"id\":1}", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_extract_columns("[{\"id\":1]", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_extract_columns("[] []", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_extract_columns_ndjson("{\"id\":1} {\"id\":2}", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_extract_columns_ndjson("{\"id\":1}\n{\"x\":tru}", cols, 3, &rows));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_extract_columns_ndjson(" \n ", cols, 3, &rows));
+    EXPECT_EQ_SIZE_T(0, rows);
+    lept_free_columns(cols, 3);
+}
+
+#define TEST_MINIFY(expect, json)\
+    do{\
+        char out[256];\
+        size_t len;\
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_minify(json, strlen(json), out, &len));\
+        EXPECT_EQ_STR(expect, out, len);\
+        EXPECT_EQ_INT(1, out[len] == '\0');\
+    }while(0)
+
+static void test_validate_minify(){
+    char out[64];
+    size_t len;
+    TEST_MINIFY("null", " null ");
+    TEST_MINIFY("[1,-2.5e10,\"a b\",true,false,null]", " [ 1 ,\n\t-2.5e10 , \"a b\" , true , false , null ] ");
+    TEST_MINIFY("{\"k \\\" \\u00e9\":{\"x\":[]},\"y\":{}}",
+        "{\r\n    \"k \\\" \\u00e9\" :   {  \"x\" : [ ]  } ,\n                    \"y\" : { }\n}\n");
+
+    /* 不要求以'\0'结尾 */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("[1,2]xyz", 5));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_validate("[1,2]xyz", 4));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_validate("truex", 3));
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_QUOTATION_MARK, lept_validate("\"abc\"", 4));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_UNICODE_HEX, lept_validate("\"\\u0041\"", 6));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("12345", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_INVALID_VALUE, lept_validate("1.5", 2));
+    EXPECT_EQ_INT(LEPT_PARSE_EXPECT_VALUE, lept_validate("", 0));
+    EXPECT_EQ_INT(LEPT_PARSE_ROOT_NOT_SINGULAR, lept_validate("1\0", 2));
+
+    /* 数字太大：量级估计和strtod的结果要一致 */
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("1.7976931348623157e308", 22));
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate("1.8e308", 7));
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate("1000e306", 8));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("0.001e311", 9));
+    EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate("0.01e311", 8));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("0e99999999999999999999", 22));
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate("1e-99999999999999999999", 23));
+
+    /* 特别长的数字：不能截断尾数又丢掉指数，结果要和lept_parse一样 */
+    {
+        static const char dbl_limit[] = "1."
+            "7976931348623158079372897140530341507993413271003782693617377898"
+            "0444968292764750946649017977587207096330286416692887910946555547"
+            "8519404026306574886715058206819089020007083836762738548458177115"
+            "3176447573027006985557136695962284291481986083493647529271907416"
+            "8444365510704342711559699508093042880177904174497792";
+        char* buf = (char*)malloc(1024);
+        size_t n = strlen(dbl_limit);
+        lept_value v;
+        lept_init(&v);
+        memcpy(buf, "1.8", 3);
+        memset(buf + 3, '0', 600);
+        memcpy(buf + 603, "e308", 5);
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate(buf, 607));
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_parse(&v, buf));
+        memcpy(buf, "0.", 2);
+        memset(buf + 2, '0', 600);
+        memcpy(buf + 602, "18e909", 7);
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate(buf, 608));
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_parse(&v, buf));
+        /* 溢出的分界正好是 2^1024 - 2^970（309位），等于它就溢出，差一点就不溢出 */
+        memcpy(buf, dbl_limit, n);
+        memcpy(buf + n, "e308", 5);
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate(buf, n + 4));
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_parse(&v, buf));
+        buf[n - 1] = '1';
+        memset(buf + n, '9', 300);
+        memcpy(buf + n + 300, "e308", 5);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate(buf, n + 304));
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v, buf));
+        EXPECT_EQ_DOUBLE(1.7976931348623157e308, lept_get_number(&v));
+        buf[n - 1] = '2';
+        memset(buf + n, '0', 300);
+        buf[n + 299] = '1';
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_validate(buf, n + 304));
+        EXPECT_EQ_INT(LEPT_PARSE_NUMBER_TOO_BIG, lept_parse(&v, buf));
+        lept_free(&v);
+        free(buf);
+    }
+
+    EXPECT_EQ_INT(LEPT_PARSE_MISS_COLON, lept_minify("{\"a\" 1}", 8, out, &len));
+    EXPECT_EQ_SIZE_T(0, len);
+
+    /* 嵌套很深也不会爆栈 */
+    {
+        size_t i, depth = 2000000;
+        char* buf = (char*)malloc(depth * 2);
+        memset(buf, '[', depth);
+        memset(buf + depth, ']', depth);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate(buf, depth * 2));
+        EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_validate(buf, depth * 2 - 1));
+        free(buf);
+
+        /* 数组和对象交替：每一层关的括号要对得上 */
+        depth = 3000;
+        buf = (char*)malloc(depth * 8 + 1);
+        for (i = 0; i < depth; i++)
+            memcpy(buf + i * 6, "{\"a\":[", 6);
+        buf[depth * 6] = '1';
+        for (i = 0; i < depth; i++)
+            memcpy(buf + depth * 6 + 1 + i * 2, "]}", 2);
+        EXPECT_EQ_INT(LEPT_PARSE_OK, lept_validate(buf, depth * 8 + 1));
+        buf[depth * 8] = ']';
+        EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_CURLY_BRACKET, lept_validate(buf, depth * 8 + 1));
+        buf[depth * 8] = '}';
+        buf[depth * 6 + 1] = '}';
+        EXPECT_EQ_INT(LEPT_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, lept_validate(buf, depth * 8 + 1));
+        free(buf);
+    }
+}
+
+static void test_frozen(){
+    lept_value v;
+    const lept_node *doc, *doc2, *doc3, *n, *val;
+    lept_init(&v);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&v,
+        "{\"a\":{\"b\":[1,2,3],\"c\":\"x\"},\"d\":{\"e\":true},\"a/~b\":null}"));
+    doc = lept_freeze(&v);
+    EXPECT_EQ_INT(MY_NULL, lept_get_type(&v));
+    EXPECT_EQ_INT(MY_OBJECT, lept_node_get_type(doc));
+    EXPECT_EQ_SIZE_T(3, lept_node_get_object_size(doc));
+    EXPECT_EQ_STR("a", lept_node_get_object_key(doc, 0), lept_node_get_object_key_length(doc, 0));
+    n = lept_node_get_object_value(doc, 0);
+    EXPECT_EQ_SIZE_T(2, lept_node_get_object_size(n));
+    EXPECT_EQ_SIZE_T(3, lept_node_get_array_size(lept_node_get_object_value(n, 0)));
+    EXPECT_EQ_DOUBLE(2.0, lept_node_get_number(lept_node_get_array_element(lept_node_get_object_value(n, 0), 1)));
+    EXPECT_EQ_STR("x", lept_node_get_str(lept_node_get_pointer(doc, "/a/c")), lept_node_get_str_len(lept_node_get_pointer(doc, "/a/c")));
+    EXPECT_EQ_INT(1, lept_node_get_bool(lept_node_get_pointer(doc, "/d/e")));
+    EXPECT_EQ_DOUBLE(3.0, lept_node_get_number(lept_node_get_pointer(doc, "/a/b/2")));
+    EXPECT_EQ_INT(MY_NULL, lept_node_get_type(lept_node_get_pointer(doc, "/a~1~0b")));
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc, "") == doc);
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc, "/x") == NULL);
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc, "/a/b/3") == NULL);
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc, "/a/b/01") == NULL);
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc, "/a/c/0") == NULL);
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc, "a") == NULL);
+
+    /* 改一个值：新旧两棵树都能用，没改到的子树是同一个节点 */
+    lept_init(&v);
+    lept_set_number(&v, 42);
+    val = lept_freeze(&v);
+    doc2 = lept_node_set(doc, "/a/b/1", val);
+    EXPECT_EQ_INT(1, doc2 != NULL && doc2 != doc);
+    EXPECT_EQ_DOUBLE(42.0, lept_node_get_number(lept_node_get_pointer(doc2, "/a/b/1")));
+    EXPECT_EQ_DOUBLE(2.0, lept_node_get_number(lept_node_get_pointer(doc, "/a/b/1")));
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc2, "/d") == lept_node_get_pointer(doc, "/d"));
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc2, "/a/c") == lept_node_get_pointer(doc, "/a/c"));
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc2, "/a/b/0") == lept_node_get_pointer(doc, "/a/b/0"));
+    EXPECT_EQ_INT(1, lept_node_get_pointer(doc2, "/a") != lept_node_get_pointer(doc, "/a"));
+
+    /* 释放旧的之后新的还能用 */
+    lept_node_release(doc);
+    EXPECT_EQ_INT(1, lept_node_get_bool(lept_node_get_pointer(doc2, "/d/e")));
+
+    /* 追加和删除 */
+    doc3 = lept_node_set(doc2, "/a/b/-", val);
+    EXPECT_EQ_SIZE_T(4, lept_node_get_array_size(lept_node_get_pointer(doc3, "/a/b")));
+    lept_node_release(doc2);
+    doc2 = lept_node_set(doc3, "/d/new~1key", val);
+    EXPECT_EQ_STR("new/key", lept_node_get_object_key(lept_node_get_pointer(doc2, "/d"), 1), 7);
+    EXPECT_EQ_DOUBLE(42.0, lept_node_get_number(lept_node_get_pointer(doc2, "/d/new~1key")));
+    lept_node_release(doc3);
+    doc3 = lept_node_set(doc2, "/a/c", NULL);
+    EXPECT_EQ_SIZE_T(1, lept_node_get_object_size(lept_node_get_pointer(doc3, "/a")));
+    lept_node_release(doc2);
+    doc2 = lept_node_set(doc3, "/a/b/0", NULL);
+    EXPECT_EQ_SIZE_T(3, lept_node_get_array_size(lept_node_get_pointer(doc2, "/a/b")));
+    EXPECT_EQ_DOUBLE(42.0, lept_node_get_number(lept_node_get_pointer(doc2, "/a/b/0")));
+
+    /* 路径不对 */
+    EXPECT_EQ_INT(1, lept_node_set(doc2, "/x/y", val) == NULL);
+    EXPECT_EQ_INT(1, lept_node_set(doc2, "/a/b/9", val) == NULL);
+    EXPECT_EQ_INT(1, lept_node_set(doc2, "/a/b/-", NULL) == NULL);
+    EXPECT_EQ_INT(1, lept_node_set(doc2, "/d/e/f", val) == NULL);
+    EXPECT_EQ_INT(1, lept_node_set(doc2, "/d/~2", val) == NULL);
+
+    /* 换掉整个根 */
+    doc = lept_node_set(doc2, "", val);
+    EXPECT_EQ_INT(1, doc == val);
+    lept_node_release(doc);
+
+    lept_node_release(doc2);
+    lept_node_release(doc3);
+    lept_node_release(val);
+}
+
+static void test_static(){
+    const lept_value* v = lept_static_json<" { \"n\" : null , \"t\" : true , \"f\" : false , \"i\" : 123 , \"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ], \"m\" : [ 1, \"x\", [ [], {} ] ], \"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 } } ">();
+    const lept_value *e, *a;
+    const double* nums;
+    size_t len;
+    lept_value p;
+    EXPECT_EQ_INT(MY_OBJECT, lept_get_type(v));
+    EXPECT_EQ_SIZE_T(8, lept_get_object_size(v));
+    EXPECT_EQ_STR("n", lept_get_object_key(v, 0), lept_get_object_key_length(v, 0));
+    EXPECT_EQ_INT(MY_NULL, lept_get_type(lept_get_object_value(v, 0)));
+    EXPECT_EQ_INT(MY_TRUE, lept_get_type(lept_get_object_value(v, 1)));
+    EXPECT_EQ_DOUBLE(123.0, lept_get_number(lept_get_object_value(v, 3)));
+    EXPECT_EQ_STR("abc", lept_get_str(lept_get_object_value(v, 4)), lept_get_str_len(lept_get_object_value(v, 4)));
+    /* 全是数字的数组也不存成紧凑数组，取元素时就不用写 */
+    a = lept_get_object_value(v, 5);
+    EXPECT_EQ_INT(0, lept_get_number_array(a, &nums, &len));
+    EXPECT_EQ_DOUBLE(3.0, lept_get_number(lept_get_array_element(a, 2)));
+    EXPECT_EQ_DOUBLE(2.0, lept_get_array_number(a, 1));
+    e = lept_get_array_element(lept_get_array_element(lept_get_object_value(v, 6), 2), 0);
+    EXPECT_EQ_INT(MY_ARRAY, lept_get_type(e));
+    EXPECT_EQ_SIZE_T(0, lept_get_array_size(e));
+    e = lept_get_array_element(lept_get_array_element(lept_get_object_value(v, 6), 2), 1);
+    EXPECT_EQ_INT(MY_OBJECT, lept_get_type(e));
+    EXPECT_EQ_SIZE_T(0, lept_get_object_size(e));
+    EXPECT_EQ_STR("3", lept_get_object_key(lept_get_object_value(v, 7), 2), 1);
+    EXPECT_EQ_DOUBLE(3.0, lept_get_number(lept_get_object_value(lept_get_object_value(v, 7), 2)));
+
+    /* 和运行时解析的结果相等，哈希也一样（哈希是编译期算好的，写缓存的话只读段会崩） */
+    lept_init(&p);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&p, " { \"n\" : null , \"t\" : true , \"f\" : false , \"i\" : 123 , \"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ], \"m\" : [ 1, \"x\", [ [], {} ] ], \"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 } } "));
+    EXPECT_EQ_INT(1, lept_is_equal(v, &p));
+    EXPECT_EQ_INT(1, lept_hash(v) == lept_hash(&p));
+    lept_free(&p);
+    lept_init(&p);
+    EXPECT_EQ_INT(LEPT_PARSE_OK, lept_parse(&p, "[\"a\\u0000b\", 0, {\"k\":\"\\uD834\\uDD1E\"}]"));
+    EXPECT_EQ_INT(1, lept_hash(lept_static_json<"[\"a\\u0000b\", -0, {\"k\":\"\\uD834\\uDD1E\"}]">()) == lept_hash(&p));
+    lept_free(&p);
+
+    /* 同一个字面量只有一份 */
+    EXPECT_EQ_INT(1, lept_static_json<"[1]">() == lept_static_json<"[1]">());
+
+    /* 十进制转double要和strtod一样舍入 */
+    EXPECT_EQ_DOUBLE(strtod("9007199254740993", NULL), lept_get_number(lept_static_json<"9007199254740993">()));
+    EXPECT_EQ_DOUBLE(strtod("2.2250738585072011e-308", NULL), lept_get_number(lept_static_json<"2.2250738585072011e-308">()));
+    EXPECT_EQ_DOUBLE(strtod("2.4703282292062328e-324", NULL), lept_get_number(lept_static_json<"2.4703282292062328e-324">()));
+    EXPECT_EQ_DOUBLE(strtod("1e23", NULL), lept_get_number(lept_static_json<"1e23">()));
+    EXPECT_EQ_DOUBLE(strtod("0.000000000000000000000000000001e-300", NULL), lept_get_number(lept_static_json<"0.000000000000000000000000000001e-300">()));
+    EXPECT_EQ_DOUBLE(strtod("123456789012345678901234567890", NULL), lept_get_number(lept_static_json<"123456789012345678901234567890">()));
+
+    static_assert(lept_static_check("{\"a\":[1,2,{\"b\":]}") == LEPT_PARSE_INVALID_VALUE);
+    static_assert(lept_static_check("1.7976931348623159e+308") == LEPT_PARSE_NUMBER_TOO_BIG);
+    static_assert(lept_static_check("1.7976931348623158e+308") == LEPT_PARSE_OK);
+}
+
 static void test_parse(){
     TEST_PARSE_NTF(MY_NULL, "null");
     TEST_PARSE_NTF(MY_TRUE, "true");
@@ -326,10 +1227,24 @@ static void test_parse(){
     test_access_bool();
     test_access_num();
     test_parse_arr();
+    test_parse_number_array();
     test_parse_miss_comma_or_square_bracket();
     test_parse_miss_key();
     test_parse_miss_colon();
     test_parse_miss_comma_or_curly_bracket();
+    test_parse_bind();
+    test_parse_stats();
+    test_parse_obj();
+    test_equal();
+    test_hash();
+    test_parse_step();
+    test_parse_async();
+    test_stringify();
+    test_writer();
+    test_extract_columns();
+    test_validate_minify();
+    test_frozen();
+    test_static();
 }
 
 int main(){